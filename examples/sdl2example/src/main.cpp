@@ -409,7 +409,7 @@ int main( int argc, char* args[] ) {
 							height = e.window.data2;
 //							std::cout << "w = " << e.window.data1 << " h = " << e.window.data2 << std::endl;
 							morda::Morda::inst().setViewportSize(morda::Vec2r(morda::real(width), morda::real(height)));
-							glViewport(0, 0, width, height);
+							morda::Render::setViewport(kolme::Recti(0, 0, width, height));
 							break;
 						case SDL_WINDOWEVENT_ENTER:
 							morda::Morda::inst().onMouseHover(true, 0);
@@ -417,6 +417,9 @@ int main( int argc, char* args[] ) {
 						case SDL_WINDOWEVENT_LEAVE:
 							morda::Morda::inst().onMouseHover(false, 0);
 							break;
+						case SDL_WINDOWEVENT_EXPOSED:
+							morda::Morda::inst().setWholeDamaged();
+							break;
 					}
 				}else if(e.type == SDL_MOUSEMOTION){
 					int x = 0, y = 0;
@@ -463,6 +466,10 @@ int main( int argc, char* args[] ) {
 			}
 		}
 		
+		if(!morda::Morda::inst().needsRedraw()){
+			continue;
+		}
+		
 		glClearColor( 0.5f, 0.5f, 0.5f, 1.f );
 		glClear( GL_COLOR_BUFFER_BIT );
 		
@@ -17,6 +17,7 @@
 #include "widgets/label/BlurGlass.hpp"
 
 #include "widgets/TextField.hpp"
+#include "widgets/TextView.hpp"
 #include "widgets/List.hpp"
 #include "widgets/TreeView.hpp"
 #include "widgets/DropDownSelector.hpp"
@@ -30,6 +31,85 @@ Morda::T_Instance Morda::instance;
 
 
 
+namespace{
+
+bool overlapOrTouch(const Rectr& a, const Rectr& b)noexcept{
+	return a.p.x <= b.p.x + b.d.x && b.p.x <= a.p.x + a.d.x
+			&& a.p.y <= b.p.y + b.d.y && b.p.y <= a.p.y + a.d.y;
+}
+
+Rectr unite(const Rectr& a, const Rectr& b)noexcept{
+	Vec2r p(std::min(a.p.x, b.p.x), std::min(a.p.y, b.p.y));
+	Vec2r p2(std::max(a.p.x + a.d.x, b.p.x + b.d.x), std::max(a.p.y + a.d.y, b.p.y + b.d.y));
+	return Rectr(p, p2 - p);
+}
+
+//Convert rectangle in root widget coordinates to viewport pixels, in the same way as Widget::computeViewportRect() does.
+kolme::Recti toViewportRect(const Matr4r& matrix, const Rectr& r){
+	Vec2r viewportDim = Render::getViewport().d.to<real>();
+	
+	Vec2r p = ((matrix * r.p + Vec2r(1, 1)) / 2).compMulBy(viewportDim);
+	Vec2r p2 = ((matrix * (r.p + r.d) + Vec2r(1, 1)) / 2).compMulBy(viewportDim);
+	
+	//round outwards, so that partially covered pixels are also repainted
+	kolme::Vec2i min(int(std::floor(std::min(p.x, p2.x))), int(std::floor(std::min(p.y, p2.y))));
+	kolme::Vec2i max(int(std::ceil(std::max(p.x, p2.x))), int(std::ceil(std::max(p.y, p2.y))));
+	
+	return kolme::Recti(min, max - min);
+}
+
+}
+
+
+
+void Morda::addDamage(const Rectr& rect)noexcept{
+	this->redrawNeeded = true;
+	
+	if(this->wholeDamaged){
+		return;
+	}
+	
+	if(rect.d.x <= 0 || rect.d.y <= 0){
+		return;
+	}
+	
+	Rectr r = rect;
+	
+	//merge with all overlapping rectangles
+	for(size_t i = 0; i != this->numDamageRects;){
+		if(overlapOrTouch(this->damageRects[i], r)){
+			r = unite(this->damageRects[i], r);
+			--this->numDamageRects;
+			this->damageRects[i] = this->damageRects[this->numDamageRects];
+			i = 0;//united rectangle may overlap the ones already checked
+			continue;
+		}
+		++i;
+	}
+	
+	if(this->numDamageRects == this->damageRects.size()){
+		//too many rectangles, collapse them to bounding rectangle
+		for(size_t i = 0; i != this->numDamageRects; ++i){
+			r = unite(this->damageRects[i], r);
+		}
+		this->numDamageRects = 0;
+	}
+	
+	this->damageRects[this->numDamageRects] = r;
+	++this->numDamageRects;
+}
+
+
+
+std::vector<Rectr> Morda::damage()const{
+	if(this->wholeDamaged){
+		return std::vector<Rectr>({Rectr(Vec2r(0), this->viewportSize)});
+	}
+	return std::vector<Rectr>(this->damageRects.begin(), this->damageRects.begin() + this->numDamageRects);
+}
+
+
+
 void Morda::initStandardWidgets(papki::File& fi) {
 	
 	//mount default resource pack
@@ -102,6 +182,7 @@ void Morda::initStandardWidgets(papki::File& fi) {
 	this->inflater.addWidget<RadioButton>("RadioButton");
 	this->inflater.addWidget<ChoiceGroup>("ChoiceGroup");
 	this->inflater.addWidget<MouseCursor>("MouseCursor");
+	this->inflater.addWidget<TextView>("TextView");
 	
 	
 	try{
@@ -120,6 +201,8 @@ void Morda::initStandardWidgets(papki::File& fi) {
 void Morda::setViewportSize(const morda::Vec2r& size){
 	this->viewportSize = size;
 	
+	this->setWholeDamaged();
+	
 	if(!this->rootWidget){
 		return;
 	}
@@ -131,17 +214,36 @@ void Morda::setViewportSize(const morda::Vec2r& size){
 
 void Morda::setRootWidget(const std::shared_ptr<morda::Widget>& w){
 	this->rootWidget = w;
+	
+	this->setWholeDamaged();
 
 	this->rootWidget->moveTo(morda::Vec2r(0));
 	this->rootWidget->resize(this->viewportSize);
 }
 
 void Morda::render(const Matr4r& matrix)const{
+	this->renderFrame(matrix, nullptr);
+}
+
+
+
+std::vector<kolme::Recti> Morda::renderDamage(const Matr4r& matrix)const{
+	std::vector<kolme::Recti> ret;
+	this->renderFrame(matrix, &ret);
+	return ret;
+}
+
+
+
+void Morda::renderFrame(const Matr4r& matrix, std::vector<kolme::Recti>* repainted)const{
 	if(!this->rootWidget){
 		TRACE(<< "Morda::render(): root widget is not set" << std::endl)
+		this->clearDamage();
 		return;
 	}
 	
+	Render::resetFrameStats();
+	
 	Render::setCullEnabled(true);
 	
 	morda::Matr4r m(matrix);
@@ -156,7 +258,48 @@ void Morda::render(const Matr4r& matrix)const{
 		this->rootWidget->layOut();
 	}
 	
-	this->rootWidget->renderInternal(m);
+	Widget::curClipRect = kolme::Recti(kolme::Vec2i(0), Render::getViewport().d);
+	
+	if(!repainted){
+		this->rootWidget->renderInternal(m);
+	}else if(this->wholeDamaged){
+		Render::clearColor();
+		Render::clearDepth();
+		Render::clearStencil();
+		
+		this->rootWidget->renderInternal(m);
+		
+		repainted->push_back(Render::getViewport());
+	}else{
+		bool scissorWasEnabled = Render::isScissorEnabled();
+		kolme::Recti oldScissor = Render::getScissorRect();
+		
+		Render::setScissorEnabled(true);
+		
+		for(size_t i = 0; i != this->numDamageRects; ++i){
+			kolme::Recti r = toViewportRect(m, this->damageRects[i]);
+			
+			Render::setScissorRect(r);
+			Widget::curClipRect = r;
+			
+			Render::clearColor();
+			Render::clearDepth();
+			Render::clearStencil();
+			
+			this->rootWidget->renderInternal(m);
+			
+			repainted->push_back(r);
+		}
+		
+		Render::setScissorRect(oldScissor);
+		Render::setScissorEnabled(scissorWasEnabled);
+	}
+	
+	//submit the rest of batched geometry
+	Render::flush();
+	
+	//NOTE: clear the damage after rendering, because laying out of widgets during rendering may add damage
+	this->clearDamage();
 }
 
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <vector>
+
 #include <utki/Singleton.hpp>
 
 #include "shaders/ColorPosShader.hpp"
@@ -8,9 +11,17 @@
 #include "shaders/PosTexShader.hpp"
 #include "shaders/SimpleGrayscalePosTexShader.hpp"
 #include "shaders/SimpleBlurPosTexShader.hpp"
+#include "shaders/SdfPosTexShader.hpp"
 
 #include "util/MouseButton.hpp"
 
+#include "render/RenderTargetPool.hpp"
+
+#include "fonts/FontFaceCache.hpp"
+
+#include "util/DiskCache.hpp"
+#include "util/WorkerPool.hpp"
+
 #include "Updateable.hpp"
 
 #include "Inflater.hpp"
@@ -35,6 +46,7 @@ public:
 	 * @param dotsPerPt - desired dots per point.
 	 */
 	Morda(real dotsPerInch, real dotsPerPt) :
+			svgRasterCache(64 * 1024 * 1024),
 			units(dotsPerInch, dotsPerPt)
 	{}
 
@@ -54,7 +66,38 @@ public:
 		PosTexShader posTexShader;
 		SimpleGrayscalePosTexShader simpleGrayscalePosTexShader;
 		SimpleBlurPosTexShader simpleBlurPosTexShader;
+		SdfPosTexShader sdfPosTexShader;
 	} shaders;
+	
+	/**
+	 * @brief Pool of textures and framebuffers for rendering to texture.
+	 * Used by widgets for caching their rendered contents.
+	 */
+	RenderTargetPool renderTargets;
+	
+	/**
+	 * @brief Cache of font faces.
+	 * Font files are shared by all fonts loaded from the same file.
+	 */
+	FontFaceCache fontFaces;
+	
+	/**
+	 * @brief On-disk cache of font atlases.
+	 * Fonts with fixed set of characters store their glyph textures and metrics to the cache
+	 * when they are built, and load them from the cache instead of rasterizing glyphs next time.
+	 * The cache is disabled by default, set cache directory to enable it.
+	 */
+	DiskCache fontAtlasCache;
+	
+	/**
+	 * @brief On-disk cache of rasterized SVG images.
+	 * SVG images store their rasterizations to the cache and load them from the cache instead of
+	 * rasterizing the same image of the same dimensions and DPI again. Entries are keyed by hash of the SVG file contents,
+	 * so changed image files are rasterized anew. The cache is limited to 64 megabytes by default,
+	 * least recently used rasterizations are deleted when the limit is exceeded.
+	 * The cache is disabled by default, set cache directory to enable it. The directory should not be shared with other caches.
+	 */
+	DiskCache svgRasterCache;
 
 private:
 	Updateable::Updater updater;
@@ -70,6 +113,14 @@ public:
 	 */
 	Inflater inflater;
 	
+	/**
+	 * @brief Pool of worker threads for background tasks.
+	 * Used for loading resources asynchronously and for rasterizing images in background.
+	 * Results of the tasks are to be delivered to UI thread with postToUiThread_ts().
+	 */
+	//NOTE: this should go after resMan, so that worker threads are stopped before resources are destroyed
+	WorkerPool workers;
+	
 	
 private:
 	//NOTE: this should go after resMan as it may hold references to some resources, so it should be destroyed first
@@ -98,10 +149,86 @@ public:
 	
 	/**
 	 * @brief Render GUI.
+	 * All the batched geometry is submitted to rendering API before this function returns.
+	 * Rendering statistics of the frame can be obtained with Render::getFrameStats() after that.
+	 * Clears the redraw request flag and the damaged region, see needsRedraw() and damage().
 	 * @param matrix - use this transformation matrix.
 	 */
 	void render(const Matr4r& matrix = Matr4r().identity())const;
 	
+	/**
+	 * @brief Render only damaged areas of GUI.
+	 * Same as render(), but only those parts of GUI which have changed since the last rendering are re-rendered.
+	 * Each damaged area is cleared and re-rendered with scissor test set to that area,
+	 * widgets which do not intersect the area are skipped.
+	 * The rendering target must contain the previously rendered frame, i.e. buffer-preserving swap should be used
+	 * or GUI should be rendered to an off-screen target which is then copied to screen.
+	 * @param matrix - use this transformation matrix.
+	 * @return List of re-rendered rectangles in viewport pixels. It can be used for partial presentation of the frame.
+	 */
+	std::vector<kolme::Recti> renderDamage(const Matr4r& matrix = Matr4r().identity())const;
+	
+private:
+	void renderFrame(const Matr4r& matrix, std::vector<kolme::Recti>* repainted)const;
+	
+	mutable bool redrawNeeded = true;
+	
+	constexpr static const size_t maxDamageRects_c = 8;
+	
+	//damaged areas in root widget coordinates, meaningful only if not whole viewport is damaged
+	mutable std::array<Rectr, maxDamageRects_c> damageRects;
+	mutable size_t numDamageRects = 0;
+	mutable bool wholeDamaged = true;
+	
+	void addDamage(const Rectr& rect)noexcept;
+	
+	void clearDamage()const noexcept{
+		this->redrawNeeded = false;
+		this->wholeDamaged = false;
+		this->numDamageRects = 0;
+	}
+public:
+	/**
+	 * @brief Get damaged region of GUI.
+	 * Damaged region consists of areas of GUI which have changed since the last rendering.
+	 * Note, that laying out of widgets which is done during rendering may add more damage.
+	 * @return List of damaged rectangles in root widget coordinates. If whole GUI is damaged,
+	 *         then the list consists of one rectangle covering whole viewport.
+	 */
+	std::vector<Rectr> damage()const;
+	
+	/**
+	 * @brief Check if GUI needs to be redrawn.
+	 * The flag is set when something has changed the appearance of the GUI since the last
+	 * call to render(), for example, a widget was invalidated or re-layout was requested.
+	 * Main loop of the program can use it to skip rendering of frames which would be
+	 * the same as the previous one.
+	 * @return true if GUI needs to be redrawn.
+	 * @return false otherwise.
+	 */
+	bool needsRedraw()const noexcept{
+		return this->redrawNeeded;
+	}
+	
+	/**
+	 * @brief Request rendering of a new frame.
+	 * Only the already damaged areas of the GUI will be re-rendered,
+	 * use setWholeDamaged() to re-render everything.
+	 */
+	void setRedrawNeeded()noexcept{
+		this->redrawNeeded = true;
+	}
+	
+	/**
+	 * @brief Request redrawing of the whole GUI.
+	 * Call this method when the window contents need to be redrawn for reasons external to GUI,
+	 * for example when the window was uncovered.
+	 */
+	void setWholeDamaged()noexcept{
+		this->redrawNeeded = true;
+		this->wholeDamaged = true;
+	}
+	
 	/**
 	 * @brief Initialize standard widgets library.
 	 * In addition to core widgets it is possible to use standard widgets.
@@ -1,6 +1,7 @@
 #include <papki/RootDirFile.hpp>
 
 #include "ResourceManager.hpp"
+#include "Morda.hpp"
 
 #include "util/util.hpp"
 
@@ -49,6 +50,16 @@ void ResourceManager::mountResPack(const papki::File& fi){
 	this->resPacks.push_back(std::move(rpe));
 	ASSERT(this->resPacks.back().fi)
 	ASSERT(this->resPacks.back().resScript)
+	
+	//add resources of the mounted pack to index, resources of later mounted packs override same named ones of earlier packs,
+	//within one pack the first resource with given name is used
+	size_t resPackIndex = this->resPacks.size() - 1;
+	for(const stob::Node* e = this->resPacks.back().resScript.operator->(); e; e = e->next()){
+		auto r = this->resIndex.insert(std::make_pair(std::string(e->value()), ResIndexEntry{resPackIndex, e}));
+		if(!r.second && r.first->second.resPackIndex != resPackIndex){
+			r.first->second = ResIndexEntry{resPackIndex, e};
+		}
+	}
 }
 
 
@@ -56,14 +67,13 @@ void ResourceManager::mountResPack(const papki::File& fi){
 ResourceManager::FindInScriptRet ResourceManager::findResourceInScript(const std::string& resName){
 //	TRACE(<< "ResourceManager::FindResourceInScript(): resName = " << (resName.c_str()) << std::endl)
 
-	for(auto i = this->resPacks.rbegin(); i != this->resPacks.rend(); ++i){
-		for(const stob::Node* e = i->resScript.operator->(); e; e = e->next()){
-			if(resName.compare(e->value()) == 0){
-//				TRACE(<< "ResourceManager::FindResourceInScript(): resource found" << std::endl)
-				return FindInScriptRet(*i, *e);
-			}
-		}//~for(res)
-	}//~for(resPack)
+	auto i = this->resIndex.find(resName);
+	if(i != this->resIndex.end()){
+		ASSERT(i->second.resPackIndex < this->resPacks.size())
+		ASSERT(i->second.node)
+//		TRACE(<< "ResourceManager::FindResourceInScript(): resource found" << std::endl)
+		return FindInScriptRet(this->resPacks[i->second.resPackIndex], *i->second.node);
+	}
 	TRACE(<< "resource name not found in mounted resource packs: " << resName << std::endl)
 	throw ResourceManager::Exc("resource name not found in mounted resource packs");
 }
@@ -86,9 +96,180 @@ void ResourceManager::addResource(const std::shared_ptr<Resource>& res, const st
 		ASSERT(false)
 	}
 	
+	this->retain(res);
+	
 //#ifdef DEBUG
 //	for(T_ResMap::iterator i = this->resMap->rm.begin(); i != this->resMap->rm.end(); ++i){
 //		TRACE(<< "\t" << *(*i).first << std::endl)
 //	}
 //#endif
 }
+
+
+
+void ResourceManager::postToWorkerThread(std::function<void()>&& f){
+	Morda::inst().workers.post_ts(std::move(f));
+}
+
+
+
+void ResourceManager::postToUiThread(std::function<void()>&& f){
+	Morda::inst().postToUiThread_ts(std::move(f));
+}
+
+
+
+void ResourceManager::finishAsyncLoad(const stob::Node& desc, std::shared_ptr<Resource> res, std::exception_ptr error){
+	auto i = this->asyncLoads.find(desc.value());
+	ASSERT(i != this->asyncLoads.end())
+	
+	auto callbacks = std::move(i->second);
+	this->asyncLoads.erase(i);
+	
+	if(res){
+		//the resource could have been loaded synchronously while it was being loaded asynchronously
+		auto j = this->resMap.find(desc.value());
+		if(j != this->resMap.end()){
+			if(auto r = j->second.lock()){
+				res = std::move(r);
+			}else{
+				this->resMap.erase(j);
+				this->addResource(res, desc);
+			}
+		}else{
+			this->addResource(res, desc);
+		}
+	}else{
+		try{
+			if(error){
+				std::rethrow_exception(error);
+			}
+		}catch(std::exception& e){
+			TRACE(<< "ResourceManager: asynchronous loading of resource '" << desc.value() << "' failed: " << e.what() << std::endl)
+		}catch(...){
+			TRACE(<< "ResourceManager: asynchronous loading of resource '" << desc.value() << "' failed" << std::endl)
+		}
+	}
+	
+	for(auto& cb : callbacks){
+		cb(res);
+	}
+}
+
+
+
+void ResourceManager::accountRetained(const RetainedEntry& e, bool add)noexcept{
+	auto& typeStats = this->retentionStatsByType_v[std::type_index(typeid(*e.res))];
+	
+	if(add){
+		++this->retentionStats_v.numResources;
+		this->retentionStats_v.bytes += e.bytes;
+		++typeStats.numResources;
+		typeStats.bytes += e.bytes;
+	}else{
+		ASSERT(this->retentionStats_v.numResources != 0)
+		ASSERT(typeStats.numResources != 0)
+		--this->retentionStats_v.numResources;
+		this->retentionStats_v.bytes -= e.bytes;
+		--typeStats.numResources;
+		typeStats.bytes -= e.bytes;
+		if(typeStats.numResources == 0){
+			this->retentionStatsByType_v.erase(std::type_index(typeid(*e.res)));
+		}
+	}
+}
+
+
+
+std::list<ResourceManager::RetainedEntry>::iterator ResourceManager::addRetained(const std::shared_ptr<const Resource>& res, size_t bytes){
+	ASSERT(res)
+	ASSERT(this->retainedIndex.find(res.get()) == this->retainedIndex.end())
+	
+	this->retained.push_back(RetainedEntry(std::shared_ptr<const Resource>(res), bytes));
+	auto i = std::prev(this->retained.end());
+	this->retainedIndex[res.get()] = i;
+	this->accountRetained(*i, true);
+	return i;
+}
+
+
+
+void ResourceManager::retain(const std::shared_ptr<const Resource>& res){
+	ASSERT(res)
+	
+	auto i = this->retainedIndex.find(res.get());
+	if(i != this->retainedIndex.end()){
+		auto e = i->second;
+		
+		//memory used by the resource could have changed since it was used last time
+		this->accountRetained(*e, false);
+		e->bytes = res->memoryUsage();
+		this->accountRetained(*e, true);
+		
+		this->retained.splice(this->retained.end(), this->retained, e);
+	}else{
+		size_t bytes = res->memoryUsage();
+		
+		//do not release all the retained resources for the sake of the one which does not fit into the budget anyway
+		if(this->retentionBudget_v == 0 || bytes > this->retentionBudget_v){
+			return;
+		}
+		this->addRetained(res, bytes);
+	}
+	
+	this->trim(this->retentionBudget_v);
+}
+
+
+
+void ResourceManager::setRetentionBudget(size_t bytes){
+	this->retentionBudget_v = bytes;
+	this->trim(this->retentionBudget_v);
+}
+
+
+
+void ResourceManager::pin(const std::shared_ptr<const Resource>& res){
+	ASSERT(res)
+	
+	auto i = this->retainedIndex.find(res.get());
+	if(i != this->retainedIndex.end()){
+		i->second->pinned = true;
+	}else{
+		this->addRetained(res, res->memoryUsage())->pinned = true;
+	}
+}
+
+
+
+void ResourceManager::unpin(const std::shared_ptr<const Resource>& res){
+	ASSERT(res)
+	
+	auto i = this->retainedIndex.find(res.get());
+	if(i == this->retainedIndex.end()){
+		return;
+	}
+	
+	i->second->pinned = false;
+	
+	this->trim(this->retentionBudget_v);
+}
+
+
+
+void ResourceManager::trim(size_t maxBytes){
+	//NOTE: releasing a resource may free it, move it out of the list first, so that the list is consistent at that moment
+	std::vector<std::shared_ptr<const Resource>> released;
+	
+	//NOTE: resources which report zero memory usage are only released when trimming to zero
+	for(auto i = this->retained.begin(); i != this->retained.end() && (this->retentionStats_v.bytes > maxBytes || maxBytes == 0);){
+		if(i->pinned){
+			++i;
+			continue;
+		}
+		this->accountRetained(*i, false);
+		this->retainedIndex.erase(i->res.get());
+		released.push_back(std::move(i->res));
+		i = this->retained.erase(i);
+	}
+}
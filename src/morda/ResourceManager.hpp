@@ -1,6 +1,12 @@
 #pragma once
 
 #include <map>
+#include <list>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include <exception>
+#include <functional>
 
 #include <utki/Shared.hpp>
 #include <papki/File.hpp>
@@ -47,7 +53,7 @@ class ResourceManager{
 	friend class Morda;
 	friend class Resource;
 	
-	std::map<const std::string, std::weak_ptr<Resource>> resMap;
+	std::unordered_map<std::string, std::weak_ptr<Resource>> resMap;
 
 	class ResPackEntry{
 	public:
@@ -67,6 +73,14 @@ class ResourceManager{
 
 	//list of mounted resource packs
 	T_ResPackList resPacks;
+	
+	struct ResIndexEntry{
+		size_t resPackIndex;
+		const stob::Node* node;
+	};
+	
+	//index of resource descriptions by resource name, built when resource packs are mounted
+	std::unordered_map<std::string, ResIndexEntry> resIndex;
 
 
 	class FindInScriptRet{
@@ -87,6 +101,63 @@ class ResourceManager{
 	//Add resource to resources map
 	void addResource(const std::shared_ptr<Resource>& res, const stob::Node& node);
 
+	//callbacks of resources being loaded asynchronously, by resource name
+	std::unordered_map<std::string, std::vector<std::function<void(std::shared_ptr<Resource>)>>> asyncLoads;
+	
+	void postToWorkerThread(std::function<void()>&& f);
+	
+	void postToUiThread(std::function<void()>&& f);
+	
+	//called on UI thread when asynchronous loading of the resource is finished
+	void finishAsyncLoad(const stob::Node& desc, std::shared_ptr<Resource> res, std::exception_ptr error);
+	
+public:
+	/**
+	 * @brief Statistics of retained resources.
+	 */
+	struct RetentionStats{
+		/**
+		 * @brief Number of retained resources.
+		 */
+		size_t numResources = 0;
+		
+		/**
+		 * @brief Memory used by retained resources, in bytes.
+		 * See Resource::memoryUsage().
+		 */
+		size_t bytes = 0;
+	};
+	
+private:
+	struct RetainedEntry{
+		RetainedEntry(std::shared_ptr<const Resource>&& res, size_t bytes) :
+				res(std::move(res)),
+				bytes(bytes)
+		{}
+		
+		std::shared_ptr<const Resource> res;
+		size_t bytes;
+		bool pinned = false;
+	};
+	
+	//retained resources, least recently used first
+	std::list<RetainedEntry> retained;
+	
+	std::unordered_map<const Resource*, std::list<RetainedEntry>::iterator> retainedIndex;
+	
+	size_t retentionBudget_v = 0;
+	
+	RetentionStats retentionStats_v;
+	
+	std::map<std::type_index, RetentionStats> retentionStatsByType_v;
+	
+	void accountRetained(const RetainedEntry& e, bool add)noexcept;
+	
+	//make the resource most recently used one in the retention cache
+	void retain(const std::shared_ptr<const Resource>& res);
+	
+	std::list<RetainedEntry>::iterator addRetained(const std::shared_ptr<const Resource>& res, size_t bytes);
+
 private:
 	ResourceManager() = default;
 
@@ -128,6 +199,93 @@ public:
 	 */
 	template <class T> std::shared_ptr<T> load(const char* resName);
 	
+	/**
+	 * @brief Load a resource asynchronously.
+	 * Resource file is read and decoded on a worker thread, only the final stage,
+	 * like creating textures, is done on UI thread. Resource types which do not support
+	 * decoding on worker threads are completely loaded on UI thread, but still after this function returns.
+	 * If the resource is already loaded, then the callback is called before this function returns.
+	 * If the resource is already being loaded asynchronously, then the callback is called when that loading is finished,
+	 * i.e. the resource is loaded only once.
+	 * Application should not be destroyed while asynchronous loads are in progress, since finishing of the loads
+	 * is posted to UI thread with Morda::postToUiThread_ts().
+	 * 
+	 * Example:
+	 * @code
+	 * morda::Morda::inst().resMan.loadAsync<morda::ResImage>("img_my_image_name", [](std::shared_ptr<morda::ResImage> image){
+	 *     if(image){
+	 *         //use image
+	 *     }
+	 * });
+	 * @endcode
+	 * 
+	 * @param resName - name of the resource as it appears in resource description.
+	 * @param callback - function to call on UI thread when the resource is loaded. It is passed nullptr if loading has failed.
+	 * @throw Exc if there is no resource with given name in mounted resource packs.
+	 */
+	template <class T> void loadAsync(const char* resName, std::function<void(std::shared_ptr<T>)>&& callback);
+	
+	/**
+	 * @brief Set memory budget of the retention cache.
+	 * Resource manager keeps strong references to recently used resources, so that resources which
+	 * are released by all their users are not loaded again if they are needed soon after that, like
+	 * resources of a dialog window which is opened and closed repeatedly. When memory used by
+	 * the retained resources exceeds the budget, least recently used resources are released.
+	 * Resources become used when they are loaded or found loaded by load() and loadAsync().
+	 * @param bytes - memory budget in bytes. Zero disables retention of resources which are not pinned, this is the default.
+	 */
+	void setRetentionBudget(size_t bytes);
+	
+	/**
+	 * @brief Get memory budget of the retention cache.
+	 * @return Memory budget in bytes.
+	 */
+	size_t retentionBudget()const noexcept{
+		return this->retentionBudget_v;
+	}
+	
+	/**
+	 * @brief Get statistics of retained resources.
+	 * Memory used by resources is measured when they become used, so it can be outdated for
+	 * resources which allocate memory during their lifetime, like fonts with glyph cache.
+	 * @return Total statistics of all retained resources, including pinned ones.
+	 */
+	const RetentionStats& retentionStats()const noexcept{
+		return this->retentionStats_v;
+	}
+	
+	/**
+	 * @brief Get statistics of retained resources by resource type.
+	 * @return Statistics of retained resources, including pinned ones, by dynamic type of the resource objects.
+	 */
+	const std::map<std::type_index, RetentionStats>& retentionStatsByType()const noexcept{
+		return this->retentionStatsByType_v;
+	}
+	
+	/**
+	 * @brief Pin resource.
+	 * Pinned resource stays in the retention cache regardless of the memory budget, until it is unpinned.
+	 * Memory used by pinned resources counts against the budget.
+	 * @param res - resource to pin.
+	 */
+	void pin(const std::shared_ptr<const Resource>& res);
+	
+	/**
+	 * @brief Unpin resource.
+	 * Unpinned resource stays in the retention cache as a used resource, if it fits into the budget.
+	 * @param res - resource to unpin.
+	 */
+	void unpin(const std::shared_ptr<const Resource>& res);
+	
+	/**
+	 * @brief Release retained resources.
+	 * Releases least recently used resources which are not pinned, until memory used by retained resources
+	 * is not greater than given amount. Call this function when the system is low on memory.
+	 * Note, that released resources are only freed if they are not used by anyone else.
+	 * @param maxBytes - maximum memory of retained resources to keep, in bytes. Zero releases all resources which are not pinned.
+	 */
+	void trim(size_t maxBytes = 0);
+	
 private:
 };
 
@@ -141,8 +299,40 @@ class Resource : virtual public utki::Shared{
 protected:
 	//this can only be used as a base class
 	Resource(){}
+	
+	/**
+	 * @brief Final stage of asynchronous resource loading.
+	 * Function executed on UI thread, it creates the resource from decoded data.
+	 */
+	typedef std::function<std::shared_ptr<Resource>()> T_Finisher;
+	
+	/**
+	 * @brief Decode resource on a worker thread.
+	 * Resource types which support decoding on worker threads should hide this function with their own,
+	 * which reads and decodes resource data and returns a function for creating the resource on UI thread.
+	 * This default implementation returns nullptr, which means that the resource should be loaded
+	 * with usual load() function on UI thread.
+	 * @param chain - resource description.
+	 * @param fi - file interface of the resource pack.
+	 * @return Function which finishes loading of the resource on UI thread.
+	 * @return nullptr if the resource should be loaded on UI thread.
+	 */
+	static T_Finisher decode(const stob::Node& chain, const papki::File& fi){
+		return nullptr;
+	}
 public:
 	virtual ~Resource()noexcept{}
+	
+	/**
+	 * @brief Get memory used by the resource.
+	 * Used for accounting of resources retained by resource manager.
+	 * Memory of other resources referred by this one should not be included.
+	 * Default implementation returns 0.
+	 * @return Approximate number of bytes used by the resource, including GPU memory of textures.
+	 */
+	virtual size_t memoryUsage()const noexcept{
+		return 0;
+	}
 };
 
 
@@ -151,6 +341,7 @@ template <class T> std::shared_ptr<T> ResourceManager::findResourceInResMap(cons
 	auto i = this->resMap.find(resName);
 	if(i != this->resMap.end()){
 		if(auto r = (*i).second.lock()){
+			this->retain(r);
 			return std::dynamic_pointer_cast<T>(std::move(r));
 		}
 		this->resMap.erase(i);
@@ -187,6 +378,69 @@ template <class T> std::shared_ptr<T> ResourceManager::load(const char* resName)
 
 
 
+template <class T> void ResourceManager::loadAsync(const char* resName, std::function<void(std::shared_ptr<T>)>&& callback){
+	ASSERT(callback)
+	
+	if(auto r = this->findResourceInResMap<T>(resName)){
+		callback(std::move(r));
+		return;
+	}
+	
+	auto cb = [callback](std::shared_ptr<Resource> r){
+		callback(std::dynamic_pointer_cast<T>(std::move(r)));
+	};
+	
+	{
+		auto i = this->asyncLoads.find(resName);
+		if(i != this->asyncLoads.end()){
+			i->second.push_back(std::move(cb));
+			return;
+		}
+	}
+	
+	FindInScriptRet ret = this->findResourceInScript(resName);
+	ASSERT(ret.rp.fi)
+	
+	if(!ret.e.child()){
+		throw Exc("ResourceManager::loadAsync(): resource description is empty");
+	}
+	
+	this->asyncLoads[resName].push_back(std::move(cb));
+	
+	//worker thread gets its own copies of resource description and file interface
+	std::shared_ptr<const stob::Node> desc(ret.e.clone());
+	std::shared_ptr<const papki::File> fi(ret.rp.fi->spawn());
+	
+	this->postToWorkerThread([this, desc, fi](){
+		Resource::T_Finisher finisher;
+		std::exception_ptr error;
+		try{
+			finisher = T::decode(*desc->child(), *fi);
+		}catch(...){
+			error = std::current_exception();
+		}
+		
+		this->postToUiThread([this, desc, fi, finisher, error](){
+			std::shared_ptr<Resource> r;
+			std::exception_ptr e = error;
+			if(!e){
+				try{
+					if(finisher){
+						r = finisher();
+					}else{
+						r = T::load(*desc->child(), *fi);
+					}
+				}catch(...){
+					e = std::current_exception();
+				}
+			}
+			this->finishAsyncLoad(*desc, std::move(r), e);
+		});
+	});
+}
+
+
+
 
 
 
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
 
 #include <utki/Buf.hpp>
 #include <unikod/utf8.hpp>
@@ -18,6 +21,65 @@ namespace morda{
  * @brief Basic class representing a font.
  */
 class Font{
+public:
+	/**
+	 * @brief Pre-built geometry of a string of text.
+	 * Glyph run holds quads of all glyphs of a text string laid out in a row, 4 vertices per glyph.
+	 * It can be built once with buildGlyphRun() and then rendered many times with renderString(),
+	 * this way the string layout is not repeated on every rendering.
+	 * Glyph run can only be rendered with the same font which has built it.
+	 */
+	struct GlyphRun{
+		/**
+		 * @brief Vertex positions of glyph quads.
+		 */
+		std::vector<kolme::Vec2f> verts;
+		
+		/**
+		 * @brief Texture coordinates of glyph quads.
+		 */
+		std::vector<kolme::Vec2f> texCoords;
+		
+		/**
+		 * @brief Advance of the whole string.
+		 */
+		real advance = 0;
+		
+		/**
+		 * @brief Texture pages of glyph quads.
+		 * For fonts which keep glyphs on several textures. Each entry is a pair of
+		 * texture page index and number of consecutive quads which use that page.
+		 */
+		std::vector<std::pair<unsigned, size_t>> pages;
+		
+		/**
+		 * @brief Quad indices of characters.
+		 * Element with index i is the index of the first quad of the i-th character of the text,
+		 * so the array has one element more than there are characters in the text.
+		 * Characters with empty glyphs, e.g. space character, have no quads.
+		 */
+		std::vector<size_t> charQuads = std::vector<size_t>(1, 0);
+		
+		/**
+		 * @brief Prefix sums of character advances.
+		 * Element with index i is the advance of the first i characters of the text,
+		 * so the array has one element more than there are characters in the text.
+		 */
+		std::vector<real> advances = std::vector<real>(1, 0);
+		
+		/**
+		 * @brief Text of the glyph run.
+		 * Fonts which rasterize glyphs on demand keep the text, so that the glyph run
+		 * can be rebuilt if the glyphs it refers to were evicted from the glyph cache.
+		 */
+		std::u32string text;
+		
+		/**
+		 * @brief Generation of the font's glyph cache the glyph run was built with.
+		 */
+		std::uint32_t generation = 0;
+	};
+	
 protected:
 	//Bounding box holds the dimensions of the largest loaded glyph.
 	morda::Rectr boundingBox_v;
@@ -49,6 +111,39 @@ protected:
 	 * @return Bounding box of the text string.
 	 */
 	virtual morda::Rectr stringBoundingBoxInternal(const std::u32string& str)const = 0;
+	
+	/**
+	 * @brief Build glyph run for a string of text.
+	 * @param run - glyph run object to put the string geometry to. Previous contents are discarded.
+	 * @param str - string of text to build the glyph run for.
+	 */
+	virtual void buildGlyphRunInternal(GlyphRun& run, const std::u32string& str)const = 0;
+	
+	/**
+	 * @brief Render glyph run.
+	 * @param shader - shader to render the glyph run with.
+	 * @param matrix - transformation matrix to use when rendering.
+	 * @param run - glyph run to render.
+	 * @param begin - index of the first character to render.
+	 * @param end - index of the character after the last one to render.
+	 */
+	virtual void renderGlyphRunInternal(PosTexShader& shader, const morda::Matr4r& matrix, const GlyphRun& run, size_t begin, size_t end)const = 0;
+	
+	/**
+	 * @brief Insert text into glyph run.
+	 * @param run - glyph run built by this font.
+	 * @param pos - index of the character to insert the text at.
+	 * @param str - text to insert.
+	 */
+	virtual void insertIntoGlyphRunInternal(GlyphRun& run, size_t pos, const std::u32string& str)const = 0;
+	
+	/**
+	 * @brief Erase part of the text from glyph run.
+	 * @param run - glyph run built by this font.
+	 * @param pos - index of the first character to erase.
+	 * @param n - number of characters to erase.
+	 */
+	virtual void eraseFromGlyphRunInternal(GlyphRun& run, size_t pos, size_t n)const = 0;
 public:
 	virtual ~Font()noexcept{}
 	
@@ -96,6 +191,119 @@ public:
 		return this->renderString(shader, matrix, str.c_str());
 	}
 	
+	/**
+	 * @brief Render pre-built string of text.
+	 * @param shader - shader to use for rendering.
+	 * @param matrix - transformation matrix to use when rendering.
+	 * @param run - glyph run of the string of text, built by this font.
+	 * @return Advance of the rendered text string. It can be used to position the next text string when rendering.
+	 */
+	real renderString(PosTexShader& shader, const morda::Matr4r& matrix, const GlyphRun& run)const{
+		ASSERT(run.charQuads.size() != 0)
+		this->renderGlyphRunInternal(shader, matrix, run, 0, run.charQuads.size() - 1);
+		return run.advance;
+	}
+	
+	/**
+	 * @brief Render part of pre-built string of text.
+	 * Only quads of the given characters are rendered, they are positioned the same way
+	 * as when rendering the whole glyph run.
+	 * @param shader - shader to use for rendering.
+	 * @param matrix - transformation matrix to use when rendering.
+	 * @param run - glyph run of the string of text, built by this font.
+	 * @param begin - index of the first character to render.
+	 * @param end - index of the character after the last one to render.
+	 */
+	void renderString(PosTexShader& shader, const morda::Matr4r& matrix, const GlyphRun& run, size_t begin, size_t end)const{
+		ASSERT(begin <= end)
+		ASSERT(end < run.charQuads.size())
+		this->renderGlyphRunInternal(shader, matrix, run, begin, end);
+	}
+	
+	/**
+	 * @brief Build glyph run for a string of text.
+	 * Capacity of the glyph run buffers is reused, so rebuilding the same glyph run object avoids memory allocations.
+	 * @param run - glyph run object to put the string geometry to. Previous contents are discarded.
+	 * @param str - string of text to build the glyph run for.
+	 */
+	void buildGlyphRun(GlyphRun& run, const std::u32string& str)const{
+		this->buildGlyphRunInternal(run, str);
+	}
+	
+	/**
+	 * @brief Build glyph run for a string of text.
+	 * @param str - string of text to build the glyph run for.
+	 * @return Glyph run of the string.
+	 */
+	GlyphRun buildGlyphRun(const std::u32string& str)const{
+		GlyphRun ret;
+		this->buildGlyphRunInternal(ret, str);
+		return ret;
+	}
+	
+	/**
+	 * @brief Build glyph run for a string of text.
+	 * @param str - string of text to build the glyph run for.
+	 * @return Glyph run of the string.
+	 */
+	GlyphRun buildGlyphRun(const std::string& str)const{
+		return this->buildGlyphRun(unikod::toUtf32(str));
+	}
+	
+	/**
+	 * @brief Insert text into glyph run.
+	 * Only geometry of the inserted characters is built, quads of the characters after
+	 * the insertion position are shifted by the advance of the inserted text.
+	 * @param run - glyph run built by this font.
+	 * @param pos - index of the character to insert the text at.
+	 * @param str - text to insert.
+	 */
+	void insertIntoGlyphRun(GlyphRun& run, size_t pos, const std::u32string& str)const{
+		ASSERT(pos < run.advances.size())
+		this->insertIntoGlyphRunInternal(run, pos, str);
+	}
+	
+	/**
+	 * @brief Erase part of the text from glyph run.
+	 * Quads of the characters after the erased ones are shifted back by the advance of the erased text.
+	 * @param run - glyph run built by this font.
+	 * @param pos - index of the first character to erase.
+	 * @param n - number of characters to erase.
+	 */
+	void eraseFromGlyphRun(GlyphRun& run, size_t pos, size_t n)const{
+		ASSERT(pos + n < run.advances.size())
+		this->eraseFromGlyphRunInternal(run, pos, n);
+	}
+	
+	/**
+	 * @brief Check if glyph run refers to glyphs which are no longer available.
+	 * Fonts which rasterize glyphs on demand can evict glyphs from their cache. Stale glyph run
+	 * is still rendered correctly, but it is rebuilt on every rendering, so owners of retained
+	 * glyph runs should rebuild them, see refreshGlyphRun().
+	 * @param run - glyph run built by this font.
+	 * @return true if the glyph run needs to be rebuilt.
+	 * @return false otherwise.
+	 */
+	virtual bool isGlyphRunStale(const GlyphRun& run)const noexcept{
+		return false;
+	}
+	
+	/**
+	 * @brief Rebuild glyph run if it is stale.
+	 * @param run - glyph run built by this font.
+	 * @return true if the glyph run was rebuilt.
+	 * @return false if the glyph run was up to date.
+	 */
+	bool refreshGlyphRun(GlyphRun& run)const{
+		if(!this->isGlyphRunStale(run)){
+			return false;
+		}
+		std::u32string text;
+		std::swap(text, run.text);
+		this->buildGlyphRunInternal(run, text);
+		return true;
+	}
+	
 	
 	/**
 	 * @brief Get string advance.
@@ -141,6 +349,15 @@ public:
 	 */
 	virtual real charAdvance(char32_t c)const = 0;
 	
+	/**
+	 * @brief Get bounding box of the character.
+	 * @param c - character to get the bounding box for.
+	 * @return Bounding box of the character's glyph relative to the pen position.
+	 */
+	virtual morda::Rectr charBoundingBox(char32_t c)const{
+		return this->stringBoundingBoxInternal(std::u32string(1, c));
+	}
+	
 	
 	/**
 	 * @brief Get bounding box of the string.
@@ -0,0 +1,121 @@
+#include "FontFaceCache.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "../Exc.hpp"
+
+#include "../util/DiskCache.hpp"
+
+
+using namespace morda;
+
+
+
+FontFace::FontFace(std::shared_ptr<FT_LibraryRec_> lib, std::vector<std::uint8_t>&& data, std::uint64_t dataHash) :
+		lib(std::move(lib)),
+		data(std::move(data)),
+		dataHash_v(dataHash)
+{
+	if(this->data.size() == 0){
+		throw morda::Exc("FontFace::FontFace(): font file is empty");
+	}
+
+	FT_Face f;
+	if(FT_New_Memory_Face(this->lib.get(), &*this->data.begin(), FT_Long(this->data.size()), 0/* face_index */, &f) != 0){
+		throw morda::Exc("FontFace::FontFace(): unable to create font face object");
+	}
+	this->face_v = f;
+}
+
+
+
+FontFace::~FontFace()noexcept{
+	FT_Done_Face(this->face_v);
+}
+
+
+
+std::shared_ptr<FontFace> FontFaceCache::get(const papki::File& fi){
+	{
+		auto p = this->pathHashes.find(fi.path());
+		if(p != this->pathHashes.end()){
+			auto i = this->faces.find(p->second);
+			if(i != this->faces.end()){
+				++this->stats_v.hits;
+				return i->second;
+			}
+		}
+	}
+
+	auto data = fi.loadWholeFileIntoMemory();
+	auto hash = DiskCache::hash(utki::wrapBuf(data));
+
+	this->pathHashes[fi.path()] = hash;
+
+	auto i = this->faces.find(hash);
+	if(i != this->faces.end() && i->second->fileData() == data){
+		++this->stats_v.hits;
+		return i->second;
+	}
+
+	if(!this->lib){
+		FT_Library l;
+		if(FT_Init_FreeType(&l)){
+			throw morda::Exc("FontFaceCache::get(): unable to init freetype library");
+		}
+		this->lib = std::shared_ptr<FT_LibraryRec_>(l, [](FT_Library l){FT_Done_FreeType(l);});
+	}
+
+	std::shared_ptr<FontFace> face(new FontFace(this->lib, std::move(data), hash));
+
+	//in case of hash collision the face already in the cache is kept
+	if(i == this->faces.end()){
+		this->faces[hash] = face;
+	}
+
+	++this->stats_v.misses;
+	this->updateStats();
+
+	return face;
+}
+
+
+
+void FontFaceCache::trim(){
+	for(auto i = this->faces.begin(); i != this->faces.end();){
+		if(i->second.use_count() == 1){
+			i = this->faces.erase(i);
+		}else{
+			++i;
+		}
+	}
+
+	for(auto i = this->pathHashes.begin(); i != this->pathHashes.end();){
+		if(this->faces.find(i->second) == this->faces.end()){
+			i = this->pathHashes.erase(i);
+		}else{
+			++i;
+		}
+	}
+
+	this->updateStats();
+}
+
+
+
+void FontFaceCache::clear(){
+	this->faces.clear();
+	this->pathHashes.clear();
+	this->updateStats();
+}
+
+
+
+void FontFaceCache::updateStats()noexcept{
+	this->stats_v.numFaces = this->faces.size();
+	this->stats_v.dataBytes = 0;
+	for(auto& f : this->faces){
+		this->stats_v.dataBytes += f.second->dataSize();
+	}
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <papki/File.hpp>
+
+
+//FreeType types, to avoid including FreeType headers
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+
+namespace morda{
+
+
+/**
+ * @brief Font face shared by fonts loaded from the same file.
+ * Holds contents of the font file and FreeType face object created from it.
+ * Fonts of different sizes use their own FreeType size objects of the shared face.
+ */
+class FontFace{
+	friend class FontFaceCache;
+
+	std::shared_ptr<FT_LibraryRec_> lib;
+
+	//the buffer should be alive as long as the face is alive
+	std::vector<std::uint8_t> data;
+
+	std::uint64_t dataHash_v;
+
+	FT_FaceRec_* face_v = nullptr;
+
+	FontFace(std::shared_ptr<FT_LibraryRec_> lib, std::vector<std::uint8_t>&& data, std::uint64_t dataHash);
+
+public:
+	FontFace(const FontFace&) = delete;
+	FontFace& operator=(const FontFace&) = delete;
+
+	~FontFace()noexcept;
+
+	/**
+	 * @brief Get FreeType face object.
+	 * @return FreeType face handle, i.e. FT_Face.
+	 */
+	FT_FaceRec_* face()const noexcept{
+		return this->face_v;
+	}
+
+	/**
+	 * @brief Get size of font file data held by this face.
+	 * @return Size of the font file in bytes.
+	 */
+	size_t dataSize()const noexcept{
+		return this->data.size();
+	}
+
+	/**
+	 * @brief Get font file data.
+	 * The data can be used for creating other FreeType face objects, e.g. for using them from other threads.
+	 * @return Contents of the font file.
+	 */
+	const std::vector<std::uint8_t>& fileData()const noexcept{
+		return this->data;
+	}
+
+	/**
+	 * @brief Get hash of font file data.
+	 * The hash identifies the font regardless of the path it was loaded from.
+	 * @return Hash of the font file contents.
+	 */
+	std::uint64_t dataHash()const noexcept{
+		return this->dataHash_v;
+	}
+};
+
+
+
+/**
+ * @brief Cache of font faces.
+ * Font file is parsed only once, all fonts loaded from the same file share the font face.
+ * Faces are looked up by path of the font file first, so that requesting a cached face does not read the file.
+ * Font file is read only when its path is requested for the first time, then the face is identified
+ * by the file contents, so files with the same contents share the face.
+ * Faces are kept in the cache after all fonts using them are destroyed, until trim() or clear() is called.
+ */
+class FontFaceCache{
+public:
+	/**
+	 * @brief Cache statistics.
+	 */
+	struct Stats{
+		/**
+		 * @brief Number of face requests satisfied from the cache.
+		 */
+		size_t hits = 0;
+
+		/**
+		 * @brief Number of face requests which needed parsing of the font file.
+		 */
+		size_t misses = 0;
+
+		/**
+		 * @brief Number of faces currently held by the cache.
+		 */
+		size_t numFaces = 0;
+
+		/**
+		 * @brief Size of font file data held by the cache, in bytes.
+		 */
+		size_t dataBytes = 0;
+	};
+
+private:
+	std::shared_ptr<FT_LibraryRec_> lib;
+
+	//faces by hash of the font file contents
+	std::map<std::uint64_t, std::shared_ptr<FontFace>> faces;
+
+	//hashes of the font file contents by font file path
+	std::map<std::string, std::uint64_t> pathHashes;
+
+	Stats stats_v;
+
+	void updateStats()noexcept;
+
+public:
+	FontFaceCache() = default;
+
+	FontFaceCache(const FontFaceCache&) = delete;
+	FontFaceCache& operator=(const FontFaceCache&) = delete;
+
+	/**
+	 * @brief Get font face.
+	 * If the face for the file path is not in the cache then the font file is read and the face is
+	 * looked up by the file contents. If there is no face for such contents, it is created.
+	 * @param fi - font file.
+	 * @return Font face.
+	 * @throw morda::Exc if font face could not be created.
+	 */
+	std::shared_ptr<FontFace> get(const papki::File& fi);
+
+	/**
+	 * @brief Remove faces which are not used by any font from the cache.
+	 */
+	void trim();
+
+	/**
+	 * @brief Remove all faces from the cache.
+	 * Faces still used by fonts will be destroyed when those fonts are destroyed.
+	 */
+	void clear();
+
+	/**
+	 * @brief Get cache statistics.
+	 * @return Cache statistics.
+	 */
+	const Stats& stats()const noexcept{
+		return this->stats_v;
+	}
+
+	/**
+	 * @brief Reset hit and miss counters.
+	 */
+	void resetCounters()noexcept{
+		this->stats_v.hits = 0;
+		this->stats_v.misses = 0;
+	}
+};
+
+}
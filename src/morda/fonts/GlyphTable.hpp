@@ -0,0 +1,258 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <utki/debug.hpp>
+
+
+namespace morda{
+
+
+/**
+ * @brief Table of glyphs indexed by character.
+ * Characters of the Basic Multilingual Plane are stored in directly indexed blocks of 256 entries,
+ * which are allocated when the first character of the block is added. Block of Latin-1 characters
+ * is always allocated. Characters outside of the BMP are stored in open addressing hash table.
+ * All lookups are exception free.
+ * @param T - glyph type, should be default constructible and copyable.
+ */
+template <class T> class GlyphTable{
+	constexpr static const char32_t blockSize_c = 0x100;
+	constexpr static const char32_t bmpEnd_c = 0x10000;
+
+	struct Entry{
+		T glyph;
+		bool valid = false;
+	};
+
+	typedef std::array<Entry, blockSize_c> Block;
+
+	std::vector<std::unique_ptr<Block>> blocks;
+
+	//=== hash table for characters outside of BMP
+	enum class State_e{
+		EMPTY,
+		USED,
+		DELETED
+	};
+
+	struct HashEntry{
+		char32_t c;
+		State_e state = State_e::EMPTY;
+		T glyph;
+	};
+
+	//size is always a power of 2
+	std::vector<HashEntry> hash;
+
+	//number of used and deleted entries of the hash table
+	size_t hashLoad = 0;
+	//=== ~~~
+
+	size_t size_v = 0;
+
+	static size_t hashIndex(char32_t c, size_t mask)noexcept{
+		return size_t((std::uint32_t(c) * 2654435761u) >> 8) & mask;
+	}
+
+	HashEntry* findHashEntry(char32_t c)const noexcept{
+		if(this->hash.size() == 0){
+			return nullptr;
+		}
+		size_t mask = this->hash.size() - 1;
+		for(size_t i = hashIndex(c, mask);; i = (i + 1) & mask){
+			auto& e = this->hash[i];
+			switch(e.state){
+				case State_e::EMPTY:
+					return nullptr;
+				case State_e::USED:
+					if(e.c == c){
+						return const_cast<HashEntry*>(&e);
+					}
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	void rehash(size_t newSize){
+		std::vector<HashEntry> old;
+		old.swap(this->hash);
+		this->hash.resize(newSize);
+		this->hashLoad = 0;
+		size_t mask = newSize - 1;
+		for(auto& e : old){
+			if(e.state != State_e::USED){
+				continue;
+			}
+			size_t i = hashIndex(e.c, mask);
+			while(this->hash[i].state != State_e::EMPTY){
+				i = (i + 1) & mask;
+			}
+			this->hash[i] = std::move(e);
+			++this->hashLoad;
+		}
+	}
+
+public:
+	GlyphTable() :
+			blocks(bmpEnd_c / blockSize_c)
+	{
+		this->blocks[0] = std::unique_ptr<Block>(new Block());
+	}
+
+	GlyphTable(const GlyphTable&) = delete;
+	GlyphTable& operator=(const GlyphTable&) = delete;
+
+	GlyphTable(GlyphTable&&) = default;
+	GlyphTable& operator=(GlyphTable&&) = default;
+
+	/**
+	 * @brief Find glyph.
+	 * @param c - character to find the glyph for.
+	 * @return pointer to the glyph.
+	 * @return nullptr if there is no glyph for the character in the table.
+	 */
+	T* find(char32_t c)noexcept{
+		if(c < bmpEnd_c){
+			auto& b = this->blocks[c / blockSize_c];
+			if(!b){
+				return nullptr;
+			}
+			auto& e = (*b)[c % blockSize_c];
+			return e.valid ? &e.glyph : nullptr;
+		}
+		auto e = this->findHashEntry(c);
+		return e ? &e->glyph : nullptr;
+	}
+
+	/**
+	 * @brief Find glyph.
+	 * @param c - character to find the glyph for.
+	 * @return pointer to the glyph.
+	 * @return nullptr if there is no glyph for the character in the table.
+	 */
+	const T* find(char32_t c)const noexcept{
+		return const_cast<GlyphTable*>(this)->find(c);
+	}
+
+	/**
+	 * @brief Get glyph, adding it if needed.
+	 * @param c - character to get the glyph for.
+	 * @return reference to the glyph. If the glyph was not in the table, a default constructed glyph is added.
+	 */
+	T& operator[](char32_t c){
+		if(c < bmpEnd_c){
+			auto& b = this->blocks[c / blockSize_c];
+			if(!b){
+				b = std::unique_ptr<Block>(new Block());
+			}
+			auto& e = (*b)[c % blockSize_c];
+			if(!e.valid){
+				e.glyph = T();
+				e.valid = true;
+				++this->size_v;
+			}
+			return e.glyph;
+		}
+
+		if(auto e = this->findHashEntry(c)){
+			return e->glyph;
+		}
+
+		//keep load factor below 1/2
+		if((this->hashLoad + 1) * 2 > this->hash.size()){
+			this->rehash(std::max(size_t(16), this->hash.size() * 2));
+		}
+
+		size_t mask = this->hash.size() - 1;
+		size_t i = hashIndex(c, mask);
+		while(this->hash[i].state == State_e::USED){
+			i = (i + 1) & mask;
+		}
+		auto& e = this->hash[i];
+		if(e.state == State_e::EMPTY){
+			++this->hashLoad;
+		}
+		e.c = c;
+		e.state = State_e::USED;
+		e.glyph = T();
+		++this->size_v;
+		return e.glyph;
+	}
+
+	/**
+	 * @brief Remove glyph from the table.
+	 * @param c - character to remove the glyph of.
+	 */
+	void erase(char32_t c)noexcept{
+		if(c < bmpEnd_c){
+			auto& b = this->blocks[c / blockSize_c];
+			if(!b){
+				return;
+			}
+			auto& e = (*b)[c % blockSize_c];
+			if(e.valid){
+				e.valid = false;
+				--this->size_v;
+			}
+			return;
+		}
+		if(auto e = this->findHashEntry(c)){
+			e->state = State_e::DELETED;
+			--this->size_v;
+		}
+	}
+
+	/**
+	 * @brief Remove all glyphs from the table.
+	 */
+	void clear(){
+		for(auto& b : this->blocks){
+			b.reset();
+		}
+		this->blocks[0] = std::unique_ptr<Block>(new Block());
+		this->hash.clear();
+		this->hashLoad = 0;
+		this->size_v = 0;
+	}
+
+	/**
+	 * @brief Get number of glyphs in the table.
+	 * @return Number of glyphs.
+	 */
+	size_t size()const noexcept{
+		return this->size_v;
+	}
+
+	/**
+	 * @brief Call function for each glyph in the table.
+	 * @param f - function to call, it is passed the character and the glyph.
+	 */
+	template <class F> void forEach(F f)const{
+		for(size_t i = 0; i != this->blocks.size(); ++i){
+			auto& b = this->blocks[i];
+			if(!b){
+				continue;
+			}
+			for(size_t j = 0; j != b->size(); ++j){
+				auto& e = (*b)[j];
+				if(e.valid){
+					f(char32_t(i * blockSize_c + j), e.glyph);
+				}
+			}
+		}
+		for(auto& e : this->hash){
+			if(e.state == State_e::USED){
+				f(e.c, e.glyph);
+			}
+		}
+	}
+};
+
+}
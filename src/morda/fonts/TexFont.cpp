@@ -1,7 +1,15 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <system_error>
+#include <thread>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_SIZES_H
 
 
 #include <utki/debug.hpp>
@@ -9,6 +17,8 @@
 #include "../util/Image.hpp"
 #include "../util/util.hpp"
 
+#include "../Morda.hpp"
+
 #include "TexFont.hpp"
 
 
@@ -47,197 +57,613 @@ static unsigned FindNextPowOf2(unsigned n){
 	return ret;
 }
 
-const unsigned DXGap = 1;
-const unsigned DYGap = 1;
+//Number of empty pixels between glyphs on the texture.
+const unsigned glyphGap_c = 1;
 
 constexpr const char32_t unknownChar_c = 0xfffd;
 
-}//~namespace
+//Maximum number of glyph quads which can be rendered with 16 bit vertex indices at once.
+const size_t maxQuadsPerDraw_c = 0x10000 / 4;
+
+//Indices of quads for rendering them as triangles, same for all glyph runs.
+std::vector<std::uint16_t> quadIndices;
+
+void growQuadIndices(size_t numQuads){
+	ASSERT(numQuads <= maxQuadsPerDraw_c)
+	for(size_t i = quadIndices.size() / 6; i < numQuads; ++i){
+		std::uint16_t v = std::uint16_t(i * 4);
+		quadIndices.push_back(v);
+		quadIndices.push_back(v + 1);
+		quadIndices.push_back(v + 2);
+		quadIndices.push_back(v);
+		quadIndices.push_back(v + 2);
+		quadIndices.push_back(v + 3);
+	}
+}
 
+//Dimension of dynamic font texture pages, unless glyphs are too big for that.
+const unsigned pageDim_c = 512;
 
+//Render glyph image with outline from the FreeType glyph slot. Returns empty image for empty glyphs (e.g. space character).
+Image renderGlyphImage(FT_GlyphSlot slot, unsigned outline){
+	if(!slot->bitmap.buffer){
+		return Image();
+	}
+	
+	Image glyphim(kolme::Vec2ui(slot->bitmap.width, slot->bitmap.rows), Image::ColorDepth_e::GREY, slot->bitmap.buffer);
 
-void TexFont::load(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline){
-	std::u32string fontChars = chars;
-	fontChars.append(1, unknownChar_c);
+	Image im(kolme::Vec2ui(glyphim.dim().x + 2 * outline, glyphim.dim().y + 2 * outline), Image::ColorDepth_e::GREYA);
+	im.clear();
+	if(outline == 0){
+		im.blit(0, 0, glyphim, 1, 0);
+	}else{
+		im.blit(outline, outline, glyphim, 0, 0);
+
+		for(unsigned y = 0; y < 2 * outline + 1; ++y){
+			for(unsigned x = 0; x < 2 * outline + 1; ++x){
+				int dx = int(x) - int(outline);
+				int dy = int(y) - int(outline);
+				if(utki::pow2(dx) + utki::pow2(dy) <= int(utki::pow2(outline))){
+//				if(ting::Abs(dx) + ting::Abs(dy) <= int(outline)){
+					BlitIfGreater(im, 1, glyphim, 0, x, y);
+				}
+			}
+		}
+	}
+	return im;
+}
+
+//Size of glyphs in signed distance field atlas, in pixels.
+const unsigned sdfBaseSize_c = 48;
+
+//Maximum distance stored in signed distance field atlas, in pixels of the atlas glyphs.
+const unsigned sdfSpread_c = 6;
+
+//Compute distances to the nearest pixel with the 'inside' flag set using 8-point sequential euclidean distance transform.
+std::vector<float> distanceTransform(const std::vector<bool>& inside, unsigned w, unsigned h){
+	const int far_c = 0x7fff;
 	
-//	TRACE(<< "TexFont::Load(): enter" << std::endl)
+	std::vector<kolme::Vec2i> grid(w * h);
+	for(size_t i = 0; i != grid.size(); ++i){
+		grid[i] = inside[i] ? kolme::Vec2i(0) : kolme::Vec2i(far_c);
+	}
+	
+	auto compare = [&grid, w, h](int x, int y, int dx, int dy){
+		int ox = x + dx;
+		int oy = y + dy;
+		if(ox < 0 || oy < 0 || ox >= int(w) || oy >= int(h)){
+			return;
+		}
+		kolme::Vec2i& p = grid[y * w + x];
+		kolme::Vec2i o = grid[oy * w + ox];
+		if(o.x == far_c){
+			return;
+		}
+		o += kolme::Vec2i(dx, dy);
+		if(o.x * o.x + o.y * o.y < p.x * p.x + p.y * p.y || p.x == far_c){
+			p = o;
+		}
+	};
+	
+	for(int y = 0; y != int(h); ++y){
+		for(int x = 0; x != int(w); ++x){
+			compare(x, y, -1, 0);
+			compare(x, y, 0, -1);
+			compare(x, y, -1, -1);
+			compare(x, y, 1, -1);
+		}
+		for(int x = int(w) - 1; x >= 0; --x){
+			compare(x, y, 1, 0);
+		}
+	}
+	
+	for(int y = int(h) - 1; y >= 0; --y){
+		for(int x = int(w) - 1; x >= 0; --x){
+			compare(x, y, 1, 0);
+			compare(x, y, 0, 1);
+			compare(x, y, -1, 1);
+			compare(x, y, 1, 1);
+		}
+		for(int x = 0; x != int(w); ++x){
+			compare(x, y, -1, 0);
+		}
+	}
+	
+	std::vector<float> ret(grid.size());
+	for(size_t i = 0; i != grid.size(); ++i){
+		auto& p = grid[i];
+		ret[i] = p.x == far_c ? float(far_c) : std::sqrt(float(p.x * p.x + p.y * p.y));
+	}
+	return ret;
+}
 
-	this->glyphs.clear();//clear glyphs map if some other font was loaded previously
+//Render signed distance field of the glyph from the FreeType glyph slot. Returns empty image for empty glyphs.
+//Distance is stored as 0.5 + d / (2 * spread), where d is positive inside of the glyph.
+Image renderSdfImage(FT_GlyphSlot slot, unsigned spread){
+	if(!slot->bitmap.buffer){
+		return Image();
+	}
 	
-	class FreeTypeLibWrapper{
-		FT_Library lib;// handle to freetype library object
-	public:
-		FreeTypeLibWrapper(){
-			if(FT_Init_FreeType(&this->lib)){
-				throw utki::Exc("TexFont::Load(): unable to init freetype library");
+	Image glyphim(kolme::Vec2ui(slot->bitmap.width, slot->bitmap.rows), Image::ColorDepth_e::GREY, slot->bitmap.buffer);
+	
+	unsigned w = glyphim.dim().x + 2 * spread;
+	unsigned h = glyphim.dim().y + 2 * spread;
+	
+	std::vector<bool> inside(w * h, false);
+	std::vector<bool> outside(w * h, true);
+	for(unsigned y = 0; y != glyphim.dim().y; ++y){
+		for(unsigned x = 0; x != glyphim.dim().x; ++x){
+			if(glyphim.pixChan(x, y, 0) >= 0x80){
+				size_t i = (y + spread) * w + x + spread;
+				inside[i] = true;
+				outside[i] = false;
 			}
 		}
-		~FreeTypeLibWrapper()noexcept{
+	}
+	
+	auto distToInside = distanceTransform(inside, w, h);
+	auto distToOutside = distanceTransform(outside, w, h);
+	
+	Image im(kolme::Vec2ui(w, h), Image::ColorDepth_e::GREY);
+	for(unsigned y = 0; y != h; ++y){
+		for(unsigned x = 0; x != w; ++x){
+			size_t i = y * w + x;
+			float d = distToOutside[i] - distToInside[i];
+			float v = 0.5f + d / float(2 * spread);
+			im.pixChan(x, y, 0) = std::uint8_t(std::round(utki::clampedRange(v, 0.0f, 1.0f) * 255.0f));
+		}
+	}
+	return im;
+}
+
+//Compute glyph quad vertices from the FreeType glyph metrics.
+void glyphQuad(std::array<kolme::Vec2f, 4>& verts, const FT_Glyph_Metrics* m, unsigned outline){
+	ASSERT(outline < (unsigned(-1) >> 1))
+	verts[0] = (morda::Vec2r(real(m->horiBearingX), real(m->horiBearingY - m->height)) / (64.0f)) + morda::Vec2r(-real(outline), -real(outline));
+	verts[1] = (morda::Vec2r(real(m->horiBearingX + m->width), real(m->horiBearingY - m->height)) / (64.0f)) + morda::Vec2r(real(outline), -real(outline));
+	verts[2] = (morda::Vec2r(real(m->horiBearingX + m->width), real(m->horiBearingY)) / (64.0f)) + morda::Vec2r(real(outline), real(outline));
+	verts[3] = (morda::Vec2r(real(m->horiBearingX), real(m->horiBearingY)) / (64.0f)) + morda::Vec2r(-real(outline), real(outline));
+}
+
+//Minimal number of glyphs per thread for parallel rasterization, for small fonts it is not worth starting threads.
+const size_t minGlyphsPerRasterThread_c = 128;
+
+//Number of glyphs a rasterization thread takes at once.
+const size_t rasterBatchSize_c = 32;
+
+struct RasterizedGlyph{
+	FT_Glyph_Metrics metrics;
+	Image im;
+};
+
+//Rasterize glyphs of the characters with the given face.
+void rasterizeGlyphs(FT_Face face, const char32_t* chars, size_t num, unsigned outline, bool sdf, RasterizedGlyph* out){
+	for(size_t i = 0; i != num; ++i){
+		if(FT_Load_Char(face, FT_ULong(chars[i]), FT_LOAD_RENDER) != 0){
+			throw utki::Exc("TexFont::Load(): unable to load char");
+		}
+		
+		FT_GlyphSlot slot = face->glyph;
+		
+		out[i].metrics = slot->metrics;
+		out[i].im = sdf ? renderSdfImage(slot, sdfSpread_c) : renderGlyphImage(slot, outline);
+	}
+}
+
+//FreeType library and face objects for rasterizing glyphs in a worker thread.
+//FreeType objects can not be used from several threads at once, so each thread has its own.
+class RasterThreadFace{
+	FT_Library lib;
+public:
+	FT_Face face;
+	
+	RasterThreadFace(const std::vector<std::uint8_t>& data, unsigned fontSize){
+		if(FT_Init_FreeType(&this->lib)){
+			throw utki::Exc("TexFont::Load(): unable to init freetype library");
+		}
+		
+		if(FT_New_Memory_Face(this->lib, &*data.begin(), FT_Long(data.size()), 0/* face_index */, &this->face) != 0){
 			FT_Done_FreeType(this->lib);
+			throw utki::Exc("TexFont::Load(): unable to create font face object");
 		}
-		operator FT_Library& (){
-			return this->lib;
+		
+		if(FT_Set_Pixel_Sizes(this->face, 0, fontSize) != 0){
+			FT_Done_Face(this->face);
+			FT_Done_FreeType(this->lib);
+			throw utki::Exc("TexFont::Load(): unable to set char size");
 		}
-	} library;
+	}
+	
+	~RasterThreadFace()noexcept{
+		FT_Done_Face(this->face);
+		FT_Done_FreeType(this->lib);
+	}
+};
+
+//=== font atlas cache entry format
+//Entry starts with header, followed by glyph records and then by texture image pixels.
+//Values are in native byte order, the magic number also serves for detecting byte order mismatch.
+const std::uint32_t atlasMagic_c = 0x4d464131; //'MFA1'
+
+struct AtlasHeader{
+	std::uint32_t magic;
+	std::uint32_t numGlyphs;
+	std::uint32_t texWidth;
+	std::uint32_t texHeight;
+	std::uint32_t numChannels;
+	float boundingBox[4];
+};
+
+struct AtlasGlyph{
+	std::uint32_t c;
+	float advance;
+	float verts[8];
+	float texCoords[8];
+};
+
+std::string atlasCacheKey(const std::vector<std::uint8_t>& fontData, const std::u32string& chars, unsigned fontSize, unsigned outline, bool sdf){
+	std::uint32_t params[] = {atlasMagic_c, fontSize, outline, sdf ? 1u : 0u};
+	
+	auto h = DiskCache::hash(utki::wrapBuf(fontData));
+	h = DiskCache::hash(utki::wrapBuf(reinterpret_cast<const std::uint8_t*>(params), sizeof(params)), h);
+	h = DiskCache::hash(utki::wrapBuf(reinterpret_cast<const std::uint8_t*>(chars.data()), chars.size() * sizeof(char32_t)), h);
+	
+	return std::string("font_") + DiskCache::hashToString(h);
+}
+//=== ~~~
+
+
 
-//	TRACE(<< "TexFont::Load(): FreeType library inited" << std::endl)
+//=== glyph run editing
 
-	class FreeTypeFaceWrapper{
-		FT_Face face; // handle to face object
-		std::vector<std::uint8_t> fontFile;//the buffer should be alive as long as the Face is alive!!!
-	public:
-		FreeTypeFaceWrapper(FT_Library& lib, const papki::File& fi){
-			this->fontFile = fi.loadWholeFileIntoMemory();
-			if(FT_New_Memory_Face(lib, &*this->fontFile.begin(), int(this->fontFile.size()), 0/* face_index */, &this->face) != 0){
-				throw utki::Exc("TexFont::Load(): unable to crate font face object");
+typedef std::vector<std::pair<unsigned, size_t>> T_PageSpans;
+
+//append quads of the page to the page spans, merging with the last span if it is of the same page
+void pushPageSpan(T_PageSpans& spans, unsigned page, size_t numQuads){
+	if(numQuads == 0){
+		return;
+	}
+	if(spans.size() != 0 && spans.back().first == page){
+		spans.back().second += numQuads;
+		return;
+	}
+	spans.push_back(std::make_pair(page, numQuads));
+}
+
+T_PageSpans insertPageSpans(const T_PageSpans& spans, size_t quad, const T_PageSpans& inserted){
+	T_PageSpans ret;
+	
+	bool done = false;
+	size_t first = 0;
+	for(auto& p : spans){
+		if(!done && quad <= first + p.second){
+			pushPageSpan(ret, p.first, quad - first);
+			for(auto& i : inserted){
+				pushPageSpan(ret, i.first, i.second);
 			}
+			pushPageSpan(ret, p.first, first + p.second - quad);
+			done = true;
+		}else{
+			pushPageSpan(ret, p.first, p.second);
 		}
-		~FreeTypeFaceWrapper()noexcept{
-			FT_Done_Face(this->face);
-		}
-		operator FT_Face& (){
-			return this->face;
+		first += p.second;
+	}
+	
+	if(!done){
+		for(auto& i : inserted){
+			pushPageSpan(ret, i.first, i.second);
 		}
-	} face(library, fi);
+	}
+	
+	return ret;
+}
 
-//	TRACE(<< "TexFont::Load(): FreeType font face loaded" << std::endl)
+T_PageSpans erasePageSpans(const T_PageSpans& spans, size_t beginQuad, size_t endQuad){
+	T_PageSpans ret;
+	
+	size_t first = 0;
+	for(auto& p : spans){
+		size_t b = std::max(first, beginQuad);
+		size_t e = std::min(first + p.second, endQuad);
+		pushPageSpan(ret, p.first, b < e ? p.second - (e - b) : p.second);
+		first += p.second;
+	}
+	
+	return ret;
+}
+//=== ~~~
 
-	//set character size in pixels
+}//~namespace
+
+
+
+unsigned TexFont::maxRasterThreads_v = 0;
+
+
+
+struct TexFont::FreeTypeFace{
+	std::shared_ptr<FontFace> face;
+	
+	//the face is shared by fonts of different sizes, each font has its own size object
+	FT_Size size;
+	
+	FreeTypeFace(const papki::File& fi, unsigned fontSize) :
+			face(Morda::inst().fontFaces.get(fi))
 	{
+		if(FT_New_Size(this->face->face(), &this->size) != 0){
+			throw utki::Exc("TexFont::Load(): unable to create font size object");
+		}
+		
+		this->activate();
+		
+		//set character size in pixels
 		FT_Error error = FT_Set_Pixel_Sizes(
-				face,// handle to face object
+				this->face->face(),// handle to face object
 				0,// pixel_width (0 means "same as height")
 				fontSize
 			); // pixel_height
 
 		if(error != 0){
+			FT_Done_Size(this->size);
 			throw utki::Exc("TexFont::Load(): unable to set char size");
 		}
 	}
+	
+	~FreeTypeFace()noexcept{
+		FT_Done_Size(this->size);
+	}
+	
+	//Make size of this font current for the shared face, should be done before loading glyphs.
+	FT_Face activate(){
+		if(this->face->face()->size != this->size){
+			FT_Activate_Size(this->size);
+		}
+		return this->face->face();
+	}
+};
 
-	unsigned maxTexSize = Render::getMaxTextureSize();
 
-	//guess for texture width
-	unsigned texWidth;
-	texWidth = std::max(unsigned(128), FindNextPowOf2(unsigned(fontChars.size() / 8) * fontSize)); //divide by 8 is a good guess that all font characters will be placed in 8 rows on texture
-	texWidth = std::min(std::min(maxTexSize, unsigned(1024)), texWidth); //clamp width to min of max texture size and 1024
 
-	unsigned curTexHeight = FindNextPowOf2(fontSize);//first guess of texture height
-	unsigned curX = DXGap;
-	unsigned curY = DYGap;
-	unsigned maxHeightInRow = 0;
+struct TexFont::SdfAtlas{
+	GlyphTable<Glyph> glyphs;
+	Texture2D tex;
+	
+	//bounding box of glyphs without the distance field margins
+	Rectr boundingBox;
+};
 
-	Image texImg(kolme::Vec2ui(texWidth, curTexHeight), Image::ColorDepth_e::GREYA);
-	//clear the image because image buffer may contain trash data
-	//and glyphs will have artifacts on their edges
-	texImg.clear();
 
-	//init bounding box to invalid values
-	float left = 1000000;
-	float right = -1000000;
-	float top = -1000000;
-	float bottom = 1000000;
 
-//	TRACE(<< "TexFont::Load(): entering for loop" << std::endl)
-
-	//print all the glyphs to the image
-	for(auto c = fontChars.begin(); c != fontChars.end(); ++c){
-		if(FT_Load_Char(static_cast<FT_Face&>(face), FT_ULong(*c), FT_LOAD_RENDER) != 0){
-			throw utki::Exc("TexFont::Load(): unable to load char");
+TexFont::TexFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline, bool sdf) :
+		outline(outline)
+{
+	if(!sdf){
+		this->load(fi, chars, fontSize, outline, false);
+		return;
+	}
+	
+	this->sdf = getSdfAtlas(fi, chars);
+	this->sdfScale = real(fontSize) / real(sdfBaseSize_c);
+	
+	//outline is rendered within the distance field margins, so it cannot be thicker than the margins
+	real maxOutline = real(sdfSpread_c) * this->sdfScale;
+	if(real(outline) > maxOutline){
+		TRACE(<< "TexFont::TexFont(): outline " << outline << " is too thick for distance field font of size " << fontSize << ", clamped to " << unsigned(maxOutline) << std::endl)
+		this->outline = unsigned(maxOutline);
+	}
+	this->sdfMargin = maxOutline - real(this->outline);
+	
+	this->sdf->glyphs.forEach([this](char32_t c, const Glyph& atlasGlyph){
+		Glyph g = atlasGlyph;
+		for(auto& v : g.verts){
+			v *= this->sdfScale;
 		}
-		
-//		TRACE(<< "TexFont::Load(): char loaded" << std::endl)
+		g.advance *= this->sdfScale;
+		this->glyphs[c] = g;
+	});
+	
+	this->boundingBox_v.p = this->sdf->boundingBox.p * this->sdfScale - Vec2r(real(this->outline));
+	this->boundingBox_v.d = this->sdf->boundingBox.d * this->sdfScale + Vec2r(2 * real(this->outline));
+}
+
+
+
+TexFont::TexFont(const papki::File& fi, const std::u32string& chars){
+	this->load(fi, chars, sdfBaseSize_c, 0, true);
+}
 
-		FT_GlyphSlot slot = static_cast<FT_Face&>(face)->glyph;
 
-		if(!slot->bitmap.buffer){//if glyph is empty (e.g. space character)
-			Glyph &g = this->glyphs[*c];
-			g.advance = float(slot->metrics.horiAdvance) / (64.0f);
-			ASSERT(g.verts.size() == g.texCoords.size())
-			for(unsigned i = 0; i < g.verts.size(); ++i){
-				g.verts[i].set(0);
-				g.texCoords[i].set(0);
-			}
-			continue;
-		}
-		Image glyphim(kolme::Vec2ui(slot->bitmap.width, slot->bitmap.rows), Image::ColorDepth_e::GREY, slot->bitmap.buffer);
 
-		Image im(kolme::Vec2ui(glyphim.dim().x + 2 * outline, glyphim.dim().y + 2 * outline), Image::ColorDepth_e::GREYA);
-		im.clear();
-		if(outline == 0){
-			im.blit(0, 0, glyphim, 1, 0);
+std::shared_ptr<const TexFont::SdfAtlas> TexFont::getSdfAtlas(const papki::File& fi, const std::u32string& chars){
+	//Atlases are shared by fonts of all sizes loaded from the same file with the same set of characters.
+	//Fonts are identified by the file contents, because paths of files from different resource packs can be the same.
+	static std::map<std::pair<std::uint64_t, std::u32string>, std::weak_ptr<const SdfAtlas>> atlases;
+	
+	auto key = std::make_pair(Morda::inst().fontFaces.get(fi)->dataHash(), chars);
+	
+	auto i = atlases.find(key);
+	if(i != atlases.end()){
+		if(auto a = i->second.lock()){
+			return a;
+		}
+	}
+	
+	TexFont f(fi, chars);
+	
+	auto a = std::make_shared<SdfAtlas>();
+	a->glyphs = std::move(f.glyphs);
+	ASSERT(f.pages.size() == 1)
+	a->tex = std::move(f.pages.front().tex);
+	a->boundingBox = f.boundingBox_v;
+	
+	//drop expired atlases
+	for(auto j = atlases.begin(); j != atlases.end();){
+		if(j->second.expired()){
+			j = atlases.erase(j);
 		}else{
-			im.blit(outline, outline, glyphim, 0, 0);
-
-			for(unsigned y = 0; y < 2 * outline + 1; ++y){
-				for(unsigned x = 0; x < 2 * outline + 1; ++x){
-					int dx = int(x) - int(outline);
-					int dy = int(y) - int(outline);
-					if(utki::pow2(dx) + utki::pow2(dy) <= int(utki::pow2(outline))){
-//					if(ting::Abs(dx) + ting::Abs(dy) <= int(outline)){
-						BlitIfGreater(im, 1, glyphim, 0, x, y);
-					}
-				}
-			}
+			++j;
 		}
+	}
+	
+	atlases[key] = a;
+	
+	return a;
+}
 
-//		TRACE(<< "TexFont::Load(): glyph image created" << std::endl)
 
-		if(texImg.dim().x < curX + im.dim().x + DXGap){
-			curX = DXGap;
-			curY += maxHeightInRow + DYGap;
-			maxHeightInRow = 0;
-		}
 
-		if(texImg.dim().y < curY + im.dim().y + DYGap){
-			//grow texture size
-			unsigned newHeight = FindNextPowOf2(curY + im.dim().y + DYGap);
-			if(newHeight > maxTexSize){//if it is impossible to grow texture image height anymore
-				throw utki::Exc("TexFont::Load(): there's not enough room on the texture for all the glyphs of the requested size");
-			}
+TexFont::TexFont(const papki::File& fi, unsigned fontSize, unsigned outline, size_t maxCacheBytes) :
+		face(utki::makeUnique<FreeTypeFace>(fi, fontSize)),
+		outline(outline),
+		maxCacheBytes_v(maxCacheBytes)
+{
+	//make sure that the biggest glyph fits the page
+	unsigned maxGlyphDim = fontSize * 2 + 2 * outline + 2 * glyphGap_c;
+	unsigned dim = std::max(pageDim_c, FindNextPowOf2(maxGlyphDim));
+	dim = std::min(dim, Render::getMaxTextureSize());
+	this->pageDim = kolme::Vec2ui(dim);
+	
+	//glyphs are not known in advance, so use font's metrics for bounding box
+	auto& m = this->face->size->metrics;
+	this->boundingBox_v.p.x = -real(outline);
+	this->boundingBox_v.p.y = real(m.descender) / 64.0f - real(outline);
+	this->boundingBox_v.d.x = real(m.max_advance) / 64.0f + 2 * real(outline);
+	this->boundingBox_v.d.y = real(m.ascender - m.descender) / 64.0f + 2 * real(outline);
+}
 
-			//TODO: optimize somehow?
-			//resize texture image
-			Image copy(texImg);
-			texImg.init(kolme::Vec2ui(copy.dim().x, newHeight), copy.colorDepth());
-			texImg.clear();
-			texImg.blit(0, 0, copy);
-		}
 
-		if(im.dim().y > maxHeightInRow){
-			maxHeightInRow = im.dim().y;
-		}
 
-		//record glyph information
-		{
-			FT_Glyph_Metrics *m = &slot->metrics;
-			
-			Glyph &g = this->glyphs[*c];
-			g.advance = real(m->horiAdvance) / (64.0f);
+TexFont::~TexFont()noexcept{}
 
-			ASSERT(outline < (unsigned(-1) >> 1))
-			g.verts[0] = (morda::Vec2r(real(m->horiBearingX), real(m->horiBearingY - m->height)) / (64.0f)) + morda::Vec2r(-real(outline), -real(outline));
-			g.verts[1] = (morda::Vec2r(real(m->horiBearingX + m->width), real(m->horiBearingY - m->height)) / (64.0f)) + morda::Vec2r(real(outline), -real(outline));
-			g.verts[2] = (morda::Vec2r(real(m->horiBearingX + m->width), real(m->horiBearingY)) / (64.0f)) + morda::Vec2r(real(outline), real(outline));
-			g.verts[3] = (morda::Vec2r(real(m->horiBearingX), real(m->horiBearingY)) / (64.0f)) + morda::Vec2r(-real(outline), real(outline));
 
-			g.texCoords[0] = morda::Vec2r(real(curX), real(curY + im.dim().y));
-			g.texCoords[1] = morda::Vec2r(real(curX + im.dim().x), real(curY + im.dim().y));
-			g.texCoords[2] = morda::Vec2r(real(curX + im.dim().x), real(curY));
-			g.texCoords[3] = morda::Vec2r(real(curX), real(curY));
 
-			//update bounding box if needed
-			utki::clampTop(left, g.verts[0].x);
-			utki::clampBottom(right, g.verts[2].x);
-			utki::clampTop(bottom, g.verts[0].y);
-			utki::clampBottom(top, g.verts[2].y);
+void TexFont::load(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline, bool sdf){
+	std::u32string fontChars = chars;
+	fontChars.append(1, unknownChar_c);
+	
+//	TRACE(<< "TexFont::Load(): enter" << std::endl)
+
+	this->glyphs.clear();//clear glyphs map if some other font was loaded previously
+	
+	FreeTypeFace face(fi, fontSize);
+
+//	TRACE(<< "TexFont::Load(): FreeType font face loaded" << std::endl)
 
-			ASSERT(top - bottom >= 0) //width >= 0
-			ASSERT(right - left >= 0) //height >= 0
+	auto& atlasCache = Morda::inst().fontAtlasCache;
+	std::string atlasKey;
+	if(atlasCache.isEnabled()){
+		atlasKey = atlasCacheKey(face.face->fileData(), fontChars, fontSize, outline, sdf);
+		if(this->loadAtlas(atlasCache.load(atlasKey))){
+			return;
 		}
+	}
 
-		texImg.blit(curX, curY, im);
-		curX += im.dim().x + DXGap;
+	//init bounding box to invalid values
+	float left = 1000000;
+	float right = -1000000;
+	float top = -1000000;
+	float bottom = 1000000;
+	
+	auto startTime = std::chrono::steady_clock::now();
+	
+	std::vector<RasterizedGlyph> raster(fontChars.size());
+	
+	unsigned numThreads = maxRasterThreads_v != 0 ? maxRasterThreads_v : std::thread::hardware_concurrency();
+	utki::clampTop(numThreads, unsigned(fontChars.size() / minGlyphsPerRasterThread_c));
+	utki::clampBottom(numThreads, 1u);
+	
+	if(numThreads == 1){
+		rasterizeGlyphs(face.activate(), fontChars.data(), fontChars.size(), outline, sdf, raster.data());
+	}else{
+		//threads take batches of glyphs until all glyphs are rasterized, this thread participates with the shared face
+		std::atomic<size_t> next(0);
+		std::vector<std::exception_ptr> errors(numThreads);
+		
+		auto work = [&](unsigned t, FT_Face f){
+			try{
+				std::unique_ptr<RasterThreadFace> threadFace;
+				if(!f){
+					threadFace = utki::makeUnique<RasterThreadFace>(face.face->fileData(), fontSize);
+					f = threadFace->face;
+				}
+				for(size_t i; (i = next.fetch_add(rasterBatchSize_c)) < fontChars.size();){
+					size_t n = std::min(rasterBatchSize_c, fontChars.size() - i);
+					rasterizeGlyphs(f, &fontChars[i], n, outline, sdf, &raster[i]);
+				}
+			}catch(...){
+				errors[t] = std::current_exception();
+				//make other threads stop
+				next = fontChars.size();
+			}
+		};
+		
+		std::vector<std::thread> threads;
+		try{
+			for(unsigned t = 1; t != numThreads; ++t){
+				threads.emplace_back(work, t, FT_Face(nullptr));
+			}
+		}catch(std::system_error&){
+			//could not start more threads, rasterize with the ones already started
+		}
+		
+		work(0, face.activate());
+		
+		for(auto& t : threads){
+			t.join();
+		}
+		
+		for(auto& e : errors){
+			if(e){
+				std::rethrow_exception(e);
+			}
+		}
+		
+		numThreads = unsigned(threads.size() + 1);
+	}
+	
+	this->loadStats_v.numGlyphs = fontChars.size();
+	this->loadStats_v.numThreads = numThreads;
+	this->loadStats_v.rasterizeTime = std::uint64_t(
+			std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count()
+		);
+	
+	//images of non-empty glyphs and the characters they belong to
+	std::vector<Image> images;
+	std::vector<char32_t> imageChars;
+
+	for(size_t i = 0; i != fontChars.size(); ++i){
+		auto c = fontChars[i];
+		auto& r = raster[i];
+		
+		Glyph &g = this->glyphs[c];
+		g.advance = real(r.metrics.horiAdvance) / (64.0f);
+		
+		if(r.im.dim().x == 0){//if glyph is empty (e.g. space character)
+			ASSERT(g.verts.size() == g.texCoords.size())
+			for(unsigned j = 0; j < g.verts.size(); ++j){
+				g.verts[j].set(0);
+				g.texCoords[j].set(0);
+			}
+			continue;
+		}
+
+		//quads of distance field glyphs include the distance margins
+		glyphQuad(g.verts, &r.metrics, sdf ? sdfSpread_c : outline);
+
+		std::array<kolme::Vec2f, 4> bb;
+		glyphQuad(bb, &r.metrics, outline);
+
+		//update bounding box if needed
+		utki::clampTop(left, bb[0].x);
+		utki::clampBottom(right, bb[2].x);
+		utki::clampTop(bottom, bb[0].y);
+		utki::clampBottom(top, bb[2].y);
+
+		ASSERT(top - bottom >= 0) //width >= 0
+		ASSERT(right - left >= 0) //height >= 0
+		
+		images.push_back(std::move(r.im));
+		imageChars.push_back(c);
 	}//~for
 	
 	//save bounding box
@@ -247,69 +673,411 @@ void TexFont::load(const papki::File& fi, const std::u32string& chars, unsigned
 	this->boundingBox_v.d.y = top - bottom;
 
 //	TRACE(<< "TexFont::Load(): for loop finished" << std::endl)
-
-	//if there is only one row of characters on the texture image and it does not reach the right edge
-	//of the image, we can shrink the image, possibly.
-	if(curY == 0){
-		//TODO: optimize somehow?
-		//resize
-		Image copy(texImg);
-		texImg.init(kolme::Vec2ui(FindNextPowOf2(curX), copy.dim().y), copy.colorDepth());
-		texImg.clear();
-		texImg.blit(0, 0, copy);
+	
+	//pack all the glyphs at once, so that the texture image has its final size from the beginning
+	std::vector<kolme::Vec2ui> dims;
+	dims.reserve(images.size());
+	for(auto& im : images){
+		dims.push_back(im.dim());
+	}
+	
+	std::vector<kolme::Vec2ui> positions;
+	kolme::Vec2ui texDim;
+	try{
+		texDim = SkylinePacker::pack(dims, positions, Render::getMaxTextureSize(), glyphGap_c);
+	}catch(morda::Exc&){
+		throw utki::Exc("TexFont::Load(): there's not enough room on the texture for all the glyphs of the requested size");
+	}
+	
+	Image texImg(texDim, sdf ? Image::ColorDepth_e::GREY : Image::ColorDepth_e::GREYA);
+	//clear the image because image buffer may contain trash data
+	//and glyphs will have artifacts on their edges
+	texImg.clear();
+	
+	for(size_t i = 0; i != images.size(); ++i){
+		kolme::Vec2ui pos = positions[i];
+		auto& im = images[i];
+		
+		texImg.blit(pos.x, pos.y, im);
+		
+		Glyph &g = this->glyphs[imageChars[i]];
+		g.texCoords[0] = morda::Vec2r(real(pos.x), real(pos.y + im.dim().y));
+		g.texCoords[1] = morda::Vec2r(real(pos.x + im.dim().x), real(pos.y + im.dim().y));
+		g.texCoords[2] = morda::Vec2r(real(pos.x + im.dim().x), real(pos.y));
+		g.texCoords[3] = morda::Vec2r(real(pos.x), real(pos.y));
+		
+		for(auto& t : g.texCoords){
+			t.compDivBy(texDim.to<float>());
+		}
 	}
 
 	//fill luminance channel with 0xff
-	if(outline == 0){
+	if(outline == 0 && !sdf){
 		texImg.clear(0, 0xff);
 	}
 
-	//now the font image has its final width and heights (no more resizes will be done)
+//	TRACE(<< "TexFont::Load(): initing texture" << std::endl)
+	//all glyphs of fixed set font are on a single page
+	this->pages.clear();
+	this->pages.push_back(Page());
+	this->pages.back().tex = Texture2D(texImg);
+	
+	if(atlasKey.size() != 0){
+		auto entry = this->saveAtlas(texImg);
+		atlasCache.store(atlasKey, utki::wrapBuf(entry));
+	}
+}
+
+
 
-	//normalize texture coordinates
-	for(T_GlyphsIter i = this->glyphs.begin(); i != this->glyphs.end(); ++i){
-		for(unsigned j = 0; j < i->second.texCoords.size(); ++j){
-			i->second.texCoords[j].compDivBy(texImg.dim().to<float>());
+std::vector<std::uint8_t> TexFont::saveAtlas(const Image& texImg)const{
+	AtlasHeader h;
+	h.magic = atlasMagic_c;
+	h.numGlyphs = std::uint32_t(this->glyphs.size());
+	h.texWidth = texImg.dim().x;
+	h.texHeight = texImg.dim().y;
+	h.numChannels = texImg.numChannels();
+	h.boundingBox[0] = this->boundingBox_v.p.x;
+	h.boundingBox[1] = this->boundingBox_v.p.y;
+	h.boundingBox[2] = this->boundingBox_v.d.x;
+	h.boundingBox[3] = this->boundingBox_v.d.y;
+	
+	std::vector<std::uint8_t> ret(sizeof(h) + sizeof(AtlasGlyph) * h.numGlyphs + texImg.buf().size());
+	
+	auto p = ret.data();
+	memcpy(p, &h, sizeof(h));
+	p += sizeof(h);
+	
+	this->glyphs.forEach([&p](char32_t c, const Glyph& g){
+		ASSERT(g.page == 0)
+		AtlasGlyph ag;
+		ag.c = std::uint32_t(c);
+		ag.advance = g.advance;
+		for(unsigned i = 0; i != g.verts.size(); ++i){
+			ag.verts[i * 2] = g.verts[i].x;
+			ag.verts[i * 2 + 1] = g.verts[i].y;
+			ag.texCoords[i * 2] = g.texCoords[i].x;
+			ag.texCoords[i * 2 + 1] = g.texCoords[i].y;
 		}
+		memcpy(p, &ag, sizeof(ag));
+		p += sizeof(ag);
+	});
+	
+	memcpy(p, &*texImg.buf().begin(), texImg.buf().size());
+	
+	return ret;
+}
+
+
+
+bool TexFont::loadAtlas(const std::vector<std::uint8_t>& data){
+	AtlasHeader h;
+	if(data.size() < sizeof(h)){
+		return false;
 	}
+	memcpy(&h, data.data(), sizeof(h));
+	
+	if(h.magic != atlasMagic_c || (h.numChannels != 1 && h.numChannels != 2)){
+		return false;
+	}
+	
+	size_t expectedSize = sizeof(h) + sizeof(AtlasGlyph) * size_t(h.numGlyphs) + size_t(h.texWidth) * size_t(h.texHeight) * h.numChannels;
+	if(data.size() != expectedSize || h.texWidth == 0 || h.texHeight == 0){
+		return false;
+	}
+	
+	auto p = data.data() + sizeof(h);
+	
+	this->glyphs.clear();
+	for(std::uint32_t i = 0; i != h.numGlyphs; ++i){
+		AtlasGlyph ag;
+		memcpy(&ag, p, sizeof(ag));
+		p += sizeof(ag);
+		
+		Glyph& g = this->glyphs[char32_t(ag.c)];
+		g.advance = ag.advance;
+		for(unsigned j = 0; j != g.verts.size(); ++j){
+			g.verts[j] = kolme::Vec2f(ag.verts[j * 2], ag.verts[j * 2 + 1]);
+			g.texCoords[j] = kolme::Vec2f(ag.texCoords[j * 2], ag.texCoords[j * 2 + 1]);
+		}
+	}
+	
+	this->boundingBox_v.p.x = h.boundingBox[0];
+	this->boundingBox_v.p.y = h.boundingBox[1];
+	this->boundingBox_v.d.x = h.boundingBox[2];
+	this->boundingBox_v.d.y = h.boundingBox[3];
+	
+	Image texImg(
+			kolme::Vec2ui(h.texWidth, h.texHeight),
+			h.numChannels == 1 ? Image::ColorDepth_e::GREY : Image::ColorDepth_e::GREYA,
+			p
+		);
+	
+	this->pages.clear();
+	this->pages.push_back(Page());
+	this->pages.back().tex = Texture2D(texImg);
+	
+	return true;
+}
 
-//	TRACE(<< "TexFont::Load(): initing texture" << std::endl)
-	this->tex = Texture2D(texImg);
+
+
+size_t TexFont::cacheBytes()const noexcept{
+	size_t ret = 0;
+	for(auto& p : this->pages){
+		ret += p.tex.bytes();
+	}
+	if(this->sdf){
+		//distance field texture is shared with fonts of other sizes
+		ret += this->sdf->tex.bytes();
+	}
+	return ret;
 }
 
-const TexFont::Glyph& TexFont::findGlyph(char32_t c)const{
-	auto i = this->glyphs.find(c);
-	if(i == this->glyphs.end()){
-		return this->glyphs.at(unknownChar_c);
+
+
+const Texture2D& TexFont::pageTex(unsigned page)const noexcept{
+	if(this->sdf){
+		return this->sdf->tex;
 	}
-	return i->second;
+	ASSERT(page < this->pages.size())
+	return this->pages[page].tex;
 }
 
 
 
-real TexFont::renderGlyphInternal(PosTexShader& shader, const morda::Matr4r& matrix, char32_t ch)const{
-	const Glyph& g = this->findGlyph(ch);
+PosTexShader& TexFont::sdfShader(PosTexShader& shader)const{
+	ASSERT(this->sdf)
 	
-	shader.setMatrix(matrix);
+	SdfPosTexShader& s = Morda::inst().shaders.sdfPosTexShader;
+	
+	//take color from the shader the text was requested to be rendered with
+	if(auto cs = dynamic_cast<ColorShader*>(&shader)){
+		s.setColor(cs->color());
+	}else{
+		s.setColor(kolme::Vec4f(1.0f));
+	}
+	
+	//distance field value change per pixel of the rendered glyph
+	float step = 1.0f / (float(this->sdfScale) * float(2 * sdfSpread_c));
+	
+	float edge = 0.5f;
+	s.setEdges(edge, std::max(0.0f, edge - float(this->outline) * step), 0.5f * step);
+	
+	return s;
+}
 
-	shader.render(utki::wrapBuf(g.verts), utki::wrapBuf(g.texCoords));
 
-	return g.advance;
+
+unsigned TexFont::allocGlyphPlace(kolme::Vec2ui dim, kolme::Vec2ui& pos)const{
+	ASSERT(this->isDynamic())
+	
+	//packer area excludes the gap at the left and bottom page edges, each glyph takes the gap to its right and top
+	auto tryPlace = [dim, &pos](Page& p) -> bool{
+		if(!p.packer.insert(dim + kolme::Vec2ui(glyphGap_c), pos)){
+			return false;
+		}
+		pos += kolme::Vec2ui(glyphGap_c);
+		return true;
+	};
+	
+	auto resetPage = [this](Page& p){
+		p.packer = SkylinePacker(this->pageDim - kolme::Vec2ui(glyphGap_c));
+		p.img.clear();
+		if(this->outline == 0){
+			//luminance of glyphs without outline is always white
+			p.img.clear(0, 0xff);
+		}
+		p.dirtyBegin = 0;
+		p.dirtyEnd = p.img.dim().y;
+	};
+	
+	//new glyphs are put to the same page until it is full
+	if(this->fillPage < this->pages.size() && tryPlace(this->pages[this->fillPage])){
+		return this->fillPage;
+	}
+	
+	//allocate new page if memory limit allows
+	size_t pageBytes = size_t(this->pageDim.x) * size_t(this->pageDim.y) * 2;
+	
+	Page* lru = nullptr;
+	for(auto& p : this->pages){
+		//pages used by the current operation cannot be evicted
+		if(p.lastUsed == this->useTick){
+			continue;
+		}
+		if(!lru || p.lastUsed < lru->lastUsed){
+			lru = &p;
+		}
+	}
+	
+	if(!lru || (this->pages.size() + 1) * pageBytes <= this->maxCacheBytes_v){
+		this->pages.push_back(Page());
+		Page& p = this->pages.back();
+		p.img.init(this->pageDim, Image::ColorDepth_e::GREYA);
+		resetPage(p);
+		p.tex = Texture2D(p.img);
+		p.dirtyEnd = 0;
+		lru = &p;
+	}else{
+		//evict the least recently used page
+		for(auto c : lru->chars){
+			this->glyphs.erase(c);
+		}
+		lru->chars.clear();
+		resetPage(*lru);
+		++this->generation;
+	}
+	
+	this->fillPage = unsigned(lru - &*this->pages.begin());
+	
+	//page is empty at this point, so the glyph can only fail to fit if it is bigger than the page
+	if(!tryPlace(*lru)){
+		throw utki::Exc("TexFont: glyph does not fit the texture page");
+	}
+	
+	return this->fillPage;
+}
+
+
+
+const TexFont::Glyph* TexFont::loadGlyph(char32_t c)const{
+	ASSERT(this->isDynamic())
+	
+	FT_Face f = this->face->activate();
+	
+	if(FT_Get_Char_Index(f, FT_ULong(c)) == 0 || FT_Load_Char(f, FT_ULong(c), FT_LOAD_RENDER) != 0){
+		//font does not have glyph for this character
+		return this->loadMissingGlyph(c);
+	}
+	
+	FT_GlyphSlot slot = f->glyph;
+	
+	Image im = renderGlyphImage(slot, this->outline);
+	
+	Glyph g;
+	g.advance = real(slot->metrics.horiAdvance) / (64.0f);
+	
+	if(im.dim().x == 0){//if glyph is empty (e.g. space character)
+		for(unsigned i = 0; i < g.verts.size(); ++i){
+			g.verts[i].set(0);
+			g.texCoords[i].set(0);
+		}
+		return &(this->glyphs[c] = g);
+	}
+	
+	if(this->outline == 0){
+		im.clear(0, 0xff);
+	}
+	
+	glyphQuad(g.verts, &slot->metrics, this->outline);
+	
+	kolme::Vec2ui pos;
+	g.page = this->allocGlyphPlace(im.dim(), pos);
+	
+	Page& p = this->pages[g.page];
+	p.img.blit(pos.x, pos.y, im);
+	p.chars.push_back(c);
+	p.lastUsed = this->useTick;
+	
+	if(p.dirtyBegin == p.dirtyEnd){
+		p.dirtyBegin = pos.y;
+		p.dirtyEnd = pos.y + im.dim().y;
+	}else{
+		utki::clampTop(p.dirtyBegin, pos.y);
+		utki::clampBottom(p.dirtyEnd, pos.y + im.dim().y);
+	}
+	
+	auto texDim = p.img.dim().to<float>();
+	g.texCoords[0] = kolme::Vec2f(float(pos.x), float(pos.y + im.dim().y)).compDivBy(texDim);
+	g.texCoords[1] = kolme::Vec2f(float(pos.x + im.dim().x), float(pos.y + im.dim().y)).compDivBy(texDim);
+	g.texCoords[2] = kolme::Vec2f(float(pos.x + im.dim().x), float(pos.y)).compDivBy(texDim);
+	g.texCoords[3] = kolme::Vec2f(float(pos.x), float(pos.y)).compDivBy(texDim);
+	
+	return &(this->glyphs[c] = g);
+}
+
+
+
+const TexFont::Glyph* TexFont::loadMissingGlyph(char32_t c)const{
+	ASSERT(this->isDynamic())
+	
+	Glyph g;
+	g.advance = 0;
+	for(unsigned i = 0; i < g.verts.size(); ++i){
+		g.verts[i].set(0);
+		g.texCoords[i].set(0);
+	}
+	
+	if(c != unknownChar_c){
+		if(auto r = this->getGlyph(unknownChar_c)){
+			g = *r;
+			
+			//the entry has to be evicted along with the replacement glyph image
+			if(g.page < this->pages.size()){
+				this->pages[g.page].chars.push_back(c);
+			}
+		}
+	}
+	
+	return &(this->glyphs[c] = g);
+}
+
+
+
+void TexFont::uploadDirtyPages()const{
+	for(auto& p : this->pages){
+		if(p.dirtyBegin == p.dirtyEnd){
+			continue;
+		}
+		
+		Image rows(kolme::Vec2ui(0, p.dirtyBegin), kolme::Vec2ui(p.img.dim().x, p.dirtyEnd - p.dirtyBegin), p.img);
+		p.tex.update(kolme::Vec2ui(0, p.dirtyBegin), rows);
+		
+		p.dirtyBegin = 0;
+		p.dirtyEnd = 0;
+	}
+}
+
+
+
+const TexFont::Glyph* TexFont::getGlyph(char32_t c)const{
+	if(auto g = this->glyphs.find(c)){
+		//empty glyphs do not occupy any page
+		if(this->isDynamic() && g->page < this->pages.size()){
+			this->pages[g->page].lastUsed = this->useTick;
+		}
+		return g;
+	}
+	
+	if(!this->isDynamic()){
+		return nullptr;
+	}
+	
+	return this->loadGlyph(c);
+}
+
+
+
+const TexFont::Glyph* TexFont::findGlyphOrNull(char32_t c)const{
+	if(auto g = this->getGlyph(c)){
+		return g;
+	}
+	return this->getGlyph(unknownChar_c);
 }
 
 
 
 real TexFont::stringAdvanceInternal(const std::u32string& str)const{
+	++this->useTick;
+	
 	real ret = 0;
 
 	auto s = str.begin();
 	
 	for(; s != str.end(); ++s){
-		try{
-			const Glyph& g = this->findGlyph(*s);
-			ret += g.advance;
-		}catch(std::out_of_range&){
-			//ignore
+		if(auto g = this->findGlyphOrNull(*s)){
+			ret += g->advance;
 		}
 	}
 
@@ -327,6 +1095,8 @@ morda::Rectr TexFont::stringBoundingBoxInternal(const std::u32string& str)const{
 		return ret;
 	}
 
+	++this->useTick;
+	
 	auto s = str.begin();
 
 	real curAdvance;
@@ -334,38 +1104,46 @@ morda::Rectr TexFont::stringBoundingBoxInternal(const std::u32string& str)const{
 	real left, right, top, bottom;
 	//init with bounding box of the first glyph
 	{
-		const Glyph& g = this->findGlyph(*s);
-		left = g.verts[0].x;
-		right = g.verts[2].x;
-		top = g.verts[2].y;
-		bottom = g.verts[0].y;
-		curAdvance = g.advance;
+		const Glyph* g = this->findGlyphOrNull(*s);
+		if(!g){
+			ret.p.set(0);
+			ret.d.set(0);
+			return ret;
+		}
+		auto bb = this->glyphBoundingBox(*g);
+		left = bb.p.x;
+		right = bb.p.x + bb.d.x;
+		top = bb.p.y + bb.d.y;
+		bottom = bb.p.y;
+		curAdvance = g->advance;
 		++s;
 	}
 
 	for(; s != str.end(); ++s){
-		auto i = this->glyphs.find(*s);
-		if(i == this->glyphs.end()){
+		auto glyph = this->getGlyph(*s);
+		if(!glyph){
 			TRACE(<< "TexFont::StringBoundingLineInternal(): Character is not loaded, scan code = 0x" << std::hex << *s << std::endl)
 			continue;
 		}
 
-		const Glyph& g = i->second;
+		const Glyph& g = *glyph;
+		
+		auto bb = this->glyphBoundingBox(g);
 
-		if(g.verts[2].y > top){
-			top = g.verts[2].y;
+		if(bb.p.y + bb.d.y > top){
+			top = bb.p.y + bb.d.y;
 		}
 
-		if(g.verts[0].y < bottom){
-			bottom = g.verts[0].y;
+		if(bb.p.y < bottom){
+			bottom = bb.p.y;
 		}
 
-		if(curAdvance + g.verts[0].x < left){
-			left = curAdvance + g.verts[0].x;
+		if(curAdvance + bb.p.x < left){
+			left = curAdvance + bb.p.x;
 		}
 
-		if(curAdvance + g.verts[2].x > right){
-			right = curAdvance + g.verts[2].x;
+		if(curAdvance + bb.p.x + bb.d.x > right){
+			right = curAdvance + bb.p.x + bb.d.x;
 		}
 
 		curAdvance += g.advance;
@@ -384,44 +1162,297 @@ morda::Rectr TexFont::stringBoundingBoxInternal(const std::u32string& str)const{
 
 
 
-real TexFont::renderStringInternal(PosTexShader& shader, const morda::Matr4r& matrix, const std::u32string& str)const{
-	if(str.size() == 0){
-		shader.renderNothing();
-		return 0;
+void TexFont::buildGlyphRunInternal(GlyphRun& run, const std::u32string& str)const{
+	++this->useTick;
+	
+	run.verts.clear();
+	run.texCoords.clear();
+	run.pages.clear();
+	run.charQuads.clear();
+	
+	run.verts.reserve(str.size() * 4);
+	run.texCoords.reserve(str.size() * 4);
+	run.charQuads.reserve(str.size() + 1);
+	run.charQuads.push_back(0);
+	run.advances.clear();
+	run.advances.reserve(str.size() + 1);
+	run.advances.push_back(0);
+	
+	real advance = 0;
+	
+	for(auto c : str){
+		const Glyph* g = this->findGlyphOrNull(c);
+		if(!g){
+			run.charQuads.push_back(run.charQuads.back());
+			run.advances.push_back(advance);
+			continue;
+		}
+		
+		//skip empty glyphs, e.g. space character
+		if(g->verts[2].x > g->verts[0].x && g->verts[2].y > g->verts[0].y){
+			for(unsigned i = 0; i != g->verts.size(); ++i){
+				run.verts.push_back(g->verts[i] + kolme::Vec2f(advance, 0));
+				run.texCoords.push_back(g->texCoords[i]);
+			}
+			
+			if(run.pages.size() == 0 || run.pages.back().first != g->page){
+				run.pages.push_back(std::make_pair(g->page, size_t(0)));
+			}
+			++run.pages.back().second;
+		}
+		
+		run.charQuads.push_back(run.verts.size() / 4);
+		
+		advance += g->advance;
+		run.advances.push_back(advance);
+	}
+	
+	run.advance = advance;
+	
+	if(this->isDynamic()){
+		run.text = str;
+		run.generation = this->generation;
+	}
+}
+
+
+
+void TexFont::renderGlyphRunInternal(PosTexShader& shader, const morda::Matr4r& matrix, const GlyphRun& run, size_t begin, size_t end)const{
+	const GlyphRun* r = &run;
+	
+	if(this->isDynamic()){
+		if(this->isGlyphRunStale(run)){
+			//Some glyphs of the run could have been evicted from the cache, rebuild the run.
+			//Owners of retained glyph runs should refresh them, so that this is not repeated on every rendering.
+			ASSERT(&run != &this->runBuf)
+			this->buildGlyphRunInternal(this->runBuf, run.text);
+			r = &this->runBuf;
+		}
+		
+		++this->useTick;
+		for(auto& p : r->pages){
+			this->pages[p.first].lastUsed = this->useTick;
+		}
+		
+		this->uploadDirtyPages();
+	}
+	
+	ASSERT(r->verts.size() == r->texCoords.size())
+	ASSERT(r->verts.size() % 4 == 0)
+	ASSERT(r->charQuads.size() != 0)
+	ASSERT(r->charQuads.back() == r->verts.size() / 4)
+	ASSERT(begin <= end)
+	ASSERT(end < r->charQuads.size())
+	
+	PosTexShader& s = this->sdf ? this->sdfShader(shader) : shader;
+	
+	s.setMatrix(matrix);
+	
+	//range of quads to render
+	size_t beginQuad = r->charQuads[begin];
+	size_t endQuad = r->charQuads[end];
+	
+	if(beginQuad == endQuad){
+		s.renderNothing();
+		return;
 	}
 	
 	applySimpleAlphaBlending();
+	
+	growQuadIndices(std::min(endQuad - beginQuad, maxQuadsPerDraw_c));
+	
+	size_t first = 0;
+	for(auto& p : r->pages){
+		//intersect quads of the page with the range of quads to render
+		size_t b = std::max(first, beginQuad);
+		size_t e = std::min(first + p.second, endQuad);
+		first += p.second;
+		
+		if(b >= e){
+			continue;
+		}
+		
+		this->pageTex(p.first).bind();
+		
+		for(size_t i = b; i != e;){
+			size_t n = std::min(e - i, maxQuadsPerDraw_c);
+			s.render(
+					utki::wrapBuf(&*quadIndices.begin(), n * 6),
+					utki::wrapBuf(&r->verts[i * 4], n * 4),
+					utki::wrapBuf(&r->texCoords[i * 4], n * 4),
+					Render::Mode_e::TRIANGLES
+				);
+			i += n;
+			if(i != endQuad){
+				s.setMatrix(matrix);
+			}
+		}
+	}
+	ASSERT(first == r->verts.size() / 4)
+}
 
-	this->tex.bind();
 
-	real ret = 0;
 
-	morda::Matr4r matr(matrix);
+void TexFont::insertIntoGlyphRunInternal(GlyphRun& run, size_t pos, const std::u32string& str)const{
+	ASSERT(run.charQuads.size() == run.advances.size())
+	ASSERT(pos < run.advances.size())
+	
+	if(str.size() == 0){
+		return;
+	}
+	
+	//build geometry of the inserted text only
+	GlyphRun& piece = this->runBuf;
+	this->buildGlyphRunInternal(piece, str);
+	
+	if(this->isGlyphRunStale(run)){
+		//glyphs of the run were evicted, possibly while building the inserted piece, rebuild the whole run
+		std::u32string text;
+		std::swap(text, run.text);
+		text.insert(pos, str);
+		this->buildGlyphRunInternal(run, text);
+		return;
+	}
+	
+	real offset = run.advances[pos];
+	real delta = piece.advance;
+	
+	size_t quad = run.charQuads[pos];
+	size_t numQuads = piece.verts.size() / 4;
+	
+	for(auto& v : piece.verts){
+		v.x += offset;
+	}
+	
+	run.verts.insert(run.verts.begin() + quad * 4, piece.verts.begin(), piece.verts.end());
+	run.texCoords.insert(run.texCoords.begin() + quad * 4, piece.texCoords.begin(), piece.texCoords.end());
+	
+	for(auto i = run.verts.begin() + (quad + numQuads) * 4; i != run.verts.end(); ++i){
+		i->x += delta;
+	}
+	
+	run.charQuads.insert(run.charQuads.begin() + pos + 1, piece.charQuads.begin() + 1, piece.charQuads.end());
+	for(size_t i = pos + 1; i != pos + 1 + str.size(); ++i){
+		run.charQuads[i] += quad;
+	}
+	for(size_t i = pos + 1 + str.size(); i != run.charQuads.size(); ++i){
+		run.charQuads[i] += numQuads;
+	}
+	
+	run.advances.insert(run.advances.begin() + pos + 1, piece.advances.begin() + 1, piece.advances.end());
+	for(size_t i = pos + 1; i != pos + 1 + str.size(); ++i){
+		run.advances[i] += offset;
+	}
+	for(size_t i = pos + 1 + str.size(); i != run.advances.size(); ++i){
+		run.advances[i] += delta;
+	}
+	
+	run.pages = insertPageSpans(run.pages, quad, piece.pages);
+	
+	run.advance += delta;
+	
+	if(this->isDynamic()){
+		run.text.insert(pos, str);
+	}
+}
 
-	auto s = str.begin();
 
-	for(; s != str.end(); ++s){
-		try{
-			real advance = this->renderGlyphInternal(shader, matr, *s);
-			ret += advance;
-			matr.translate(advance, 0);
-		}catch(std::out_of_range&){
-			//ignore
-		}
+
+void TexFont::eraseFromGlyphRunInternal(GlyphRun& run, size_t pos, size_t n)const{
+	ASSERT(run.charQuads.size() == run.advances.size())
+	ASSERT(pos + n < run.advances.size())
+	
+	if(n == 0){
+		return;
+	}
+	
+	if(this->isGlyphRunStale(run)){
+		std::u32string text;
+		std::swap(text, run.text);
+		text.erase(pos, n);
+		this->buildGlyphRunInternal(run, text);
+		return;
+	}
+	
+	real delta = run.advances[pos + n] - run.advances[pos];
+	
+	size_t beginQuad = run.charQuads[pos];
+	size_t endQuad = run.charQuads[pos + n];
+	size_t numQuads = endQuad - beginQuad;
+	
+	run.verts.erase(run.verts.begin() + beginQuad * 4, run.verts.begin() + endQuad * 4);
+	run.texCoords.erase(run.texCoords.begin() + beginQuad * 4, run.texCoords.begin() + endQuad * 4);
+	
+	for(auto i = run.verts.begin() + beginQuad * 4; i != run.verts.end(); ++i){
+		i->x -= delta;
+	}
+	
+	run.charQuads.erase(run.charQuads.begin() + pos + 1, run.charQuads.begin() + pos + 1 + n);
+	for(size_t i = pos + 1; i != run.charQuads.size(); ++i){
+		run.charQuads[i] -= numQuads;
 	}
 	
+	run.advances.erase(run.advances.begin() + pos + 1, run.advances.begin() + pos + 1 + n);
+	for(size_t i = pos + 1; i != run.advances.size(); ++i){
+		run.advances[i] -= delta;
+	}
+	
+	run.pages = erasePageSpans(run.pages, beginQuad, endQuad);
+	
+	run.advance -= delta;
+	
+	if(this->isDynamic()){
+		run.text.erase(pos, n);
+	}
+}
 
-	return ret;
+
+
+real TexFont::renderStringInternal(PosTexShader& shader, const morda::Matr4r& matrix, const std::u32string& str)const{
+	this->buildGlyphRunInternal(this->runBuf, str);
+	
+	this->renderGlyphRunInternal(shader, matrix, this->runBuf, 0, this->runBuf.charQuads.size() - 1);
+	
+	return this->runBuf.advance;
 }
 
 
 
 real TexFont::charAdvance(char32_t c) const{
-	auto i = this->glyphs.find(c);
-	if(i == this->glyphs.end()){
+	++this->useTick;
+	
+	//use the same glyph as string rendering does, i.e. the unknown character glyph for missing characters
+	auto g = this->findGlyphOrNull(c);
+	if(!g){
 		return real(0);
 	}
 	
-	const Glyph& g = i->second;
-	return g.advance;
+	return g->advance;
+}
+
+
+
+morda::Rectr TexFont::charBoundingBox(char32_t c)const{
+	++this->useTick;
+	
+	auto g = this->findGlyphOrNull(c);
+	if(!g){
+		return morda::Rectr(Vec2r(0), Vec2r(0));
+	}
+	
+	return this->glyphBoundingBox(*g);
+}
+
+
+
+morda::Rectr TexFont::glyphBoundingBox(const Glyph& g)const noexcept{
+	morda::Rectr ret(g.verts[0], g.verts[2] - g.verts[0]);
+	
+	//empty glyphs have no margins
+	if(ret.d.x > 0 && ret.d.y > 0){
+		ret.p += Vec2r(this->sdfMargin);
+		ret.d -= Vec2r(2 * this->sdfMargin);
+	}
+	
+	return ret;
 }
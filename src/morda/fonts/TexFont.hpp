@@ -1,6 +1,9 @@
 #pragma once
 
 #include <map>
+#include <array>
+#include <memory>
+#include <vector>
 #include <sstream>
 #include <stdexcept>
 
@@ -14,9 +17,13 @@
 
 #include "../render/Texture2D.hpp"
 
+#include "../util/Image.hpp"
+#include "../util/SkylinePacker.hpp"
+
 #include "../shaders/PosTexShader.hpp"
 
 #include "Font.hpp"
+#include "GlyphTable.hpp"
 
 
 namespace morda{
@@ -28,6 +35,16 @@ namespace morda{
  * set of characters to a texture.
  * Then, for rendering strings of text it renders
  * row of quads with texture coordinates corresponding to string characters on the texture.
+ * 
+ * The font can also be created in dynamic mode, in which case there is no fixed set of characters.
+ * Glyphs are rasterized the first time they are needed and put to the glyph cache,
+ * which consists of several texture pages. When the cache grows over its memory limit,
+ * the least recently used page is cleared and re-used for new glyphs.
+ * 
+ * A font with fixed set of characters can also be created in signed distance field mode.
+ * In this mode the glyphs are stored as distance fields of a fixed size, the atlas is shared by
+ * all fonts of any size and outline loaded from the same file with the same set of characters.
+ * Such fonts are rendered with SdfPosTexShader, color is taken from the shader passed for rendering if it is a ColorShader.
  */
 class TexFont : public Font{
 	struct Glyph{
@@ -35,27 +52,177 @@ class TexFont : public Font{
 		std::array<kolme::Vec2f, 4> texCoords;
 
 		real advance;
+		
+		//index of the texture page holding the glyph image
+		unsigned page = 0;
 	};
+	
+	struct Page{
+		Texture2D tex;
+		
+		//Only for dynamic fonts. Copy of the texture contents, new glyphs are put here and then uploaded to the texture.
+		Image img;
+		
+		//rows of the image which are not yet uploaded to the texture
+		unsigned dirtyBegin = 0;
+		unsigned dirtyEnd = 0;
+		
+		SkylinePacker packer = SkylinePacker(kolme::Vec2ui(0));
+		
+		std::uint64_t lastUsed = 0;
+		
+		//characters which have glyphs on this page
+		std::vector<char32_t> chars;
+	};
+	
+	mutable std::vector<Page> pages;
 
-	Texture2D tex;
-
-	typedef std::map<char32_t, Glyph> T_GlyphsMap;
-	typedef T_GlyphsMap::iterator T_GlyphsIter;
-	T_GlyphsMap glyphs;
-
+	mutable GlyphTable<Glyph> glyphs;
+	
+	//glyph run buffer for rendering strings, kept to avoid memory allocations on every rendering
+	mutable GlyphRun runBuf;
+	
+	//=== distance field mode
+	struct SdfAtlas;
+	std::shared_ptr<const SdfAtlas> sdf;
+	
+	//scale from atlas glyph size to font size
+	real sdfScale = 1;
+	
+	//margin of distance field glyph quads around the visible glyph area, i.e. the glyph with outline
+	real sdfMargin = 0;
+	
+	static std::shared_ptr<const SdfAtlas> getSdfAtlas(const papki::File& fi, const std::u32string& chars);
+	
+	//creates distance field atlas font
+	TexFont(const papki::File& fi, const std::u32string& chars);
+	
+	PosTexShader& sdfShader(PosTexShader& shader)const;
+	//=== ~~~
+	
+	//=== dynamic mode
+	struct FreeTypeFace;
+	std::unique_ptr<FreeTypeFace> face;
+	
+	unsigned outline = 0;
+	kolme::Vec2ui pageDim;
+	size_t maxCacheBytes_v = 0;
+	
+	//page where new glyphs are put
+	mutable unsigned fillPage = 0;
+	
+	//incremented each time glyphs are evicted from the cache
+	mutable std::uint32_t generation = 0;
+	
+	mutable std::uint64_t useTick = 0;
+	//=== ~~~
+	
+	static unsigned maxRasterThreads_v;
+	
 public:
 	/**
 	 * @brief Constructor.
 	 * @param fi - file interface to read Truetype font from, i.e. 'ttf' file.
 	 * @param chars - set of characters to put to the font texture.
 	 * @param fontSize - size of the font in pixels.
+	 * @param outline - thickness of the outline effect. In signed distance field mode the outline
+	 *                  is limited by the distance field margins, it cannot be thicker than fontSize / 8.
+	 * @param sdf - whether to create the font in signed distance field mode.
+	 */
+	TexFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline = 0, bool sdf = false);
+	
+	/**
+	 * @brief Default memory limit of the glyph cache of dynamic fonts, in bytes.
+	 */
+	constexpr static const size_t defaultMaxCacheBytes_c = 4 * 1024 * 1024;
+	
+	/**
+	 * @brief Constructor of dynamic font.
+	 * Creates font which rasterizes glyphs on demand.
+	 * @param fi - file interface to read Truetype font from, i.e. 'ttf' file.
+	 * @param fontSize - size of the font in pixels.
 	 * @param outline - thickness of the outline effect.
+	 * @param maxCacheBytes - memory limit of the glyph cache textures, in bytes.
+	 *                        The cache may grow over the limit if all its pages are needed for a single string of text.
 	 */
-	TexFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline = 0){
-		this->load(fi, chars, fontSize, outline);
-	}
+	TexFont(const papki::File& fi, unsigned fontSize, unsigned outline = 0, size_t maxCacheBytes = defaultMaxCacheBytes_c);
 
-	~TexFont()noexcept{}
+	~TexFont()noexcept;
+	
+	/**
+	 * @brief Check if the font rasterizes glyphs on demand.
+	 * @return true if the font was created in dynamic mode.
+	 * @return false if the font has fixed set of characters.
+	 */
+	bool isDynamic()const noexcept{
+		return this->face.operator bool();
+	}
+	
+	bool isGlyphRunStale(const GlyphRun& run)const noexcept override{
+		return this->isDynamic() && run.generation != this->generation;
+	}
+	
+	/**
+	 * @brief Check if the font is in signed distance field mode.
+	 * @return true if the font renders glyphs from distance field atlas.
+	 * @return false otherwise.
+	 */
+	bool isSdf()const noexcept{
+		return this->sdf.operator bool();
+	}
+	
+	/**
+	 * @brief Get memory used by the glyph textures.
+	 * @return Number of bytes used by the glyph textures.
+	 */
+	size_t cacheBytes()const noexcept;
+	
+	/**
+	 * @brief Statistics of glyph rasterization done when the font was loaded.
+	 */
+	struct LoadStats{
+		/**
+		 * @brief Number of rasterized glyphs.
+		 */
+		size_t numGlyphs = 0;
+		
+		/**
+		 * @brief Number of threads which were rasterizing glyphs.
+		 */
+		unsigned numThreads = 0;
+		
+		/**
+		 * @brief Time spent on rasterizing glyphs, in microseconds.
+		 */
+		std::uint64_t rasterizeTime = 0;
+	};
+	
+	/**
+	 * @brief Get statistics of font loading.
+	 * Dynamic fonts rasterize glyphs on demand and have empty statistics,
+	 * as well as fonts loaded from the font atlas cache.
+	 * @return Statistics of glyph rasterization.
+	 */
+	const LoadStats& loadStats()const noexcept{
+		return this->loadStats_v;
+	}
+	
+	/**
+	 * @brief Set maximum number of threads for rasterizing glyphs when loading fonts with fixed set of characters.
+	 * Fonts with large sets of characters are rasterized by several threads, each using its own FreeType face.
+	 * @param num - maximum number of threads. Zero means the number of hardware threads, one disables parallel rasterization.
+	 */
+	static void setMaxRasterThreads(unsigned num)noexcept{
+		maxRasterThreads_v = num;
+	}
+	
+	/**
+	 * @brief Get maximum number of threads for rasterizing glyphs.
+	 * @return Maximum number of threads set with setMaxRasterThreads().
+	 */
+	static unsigned maxRasterThreads()noexcept{
+		return maxRasterThreads_v;
+	}
 
 	
 	real renderStringInternal(PosTexShader& shader, const morda::Matr4r& matrix, const std::u32string& str)const override;
@@ -64,6 +231,14 @@ public:
 	real stringAdvanceInternal(const std::u32string& str)const override;
 
 	morda::Rectr stringBoundingBoxInternal(const std::u32string& str)const override;
+	
+	void buildGlyphRunInternal(GlyphRun& run, const std::u32string& str)const override;
+	
+	void renderGlyphRunInternal(PosTexShader& shader, const morda::Matr4r& matrix, const GlyphRun& run, size_t begin, size_t end)const override;
+	
+	void insertIntoGlyphRunInternal(GlyphRun& run, size_t pos, const std::u32string& str)const override;
+	
+	void eraseFromGlyphRunInternal(GlyphRun& run, size_t pos, size_t n)const override;
 
 //	void renderTex(PosTexShader& shader, const morda::Matr4r& matrix)const{
 //		morda::Matr4r matr(matrix);
@@ -77,15 +252,43 @@ public:
 
 
 	real charAdvance(char32_t c) const override;
+	
+	morda::Rectr charBoundingBox(char32_t c)const override;
 
 	
 private:
+	LoadStats loadStats_v;
 
-	void load(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline = 0);
+	void load(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline, bool sdf);
 	
-	real renderGlyphInternal(PosTexShader& shader, const morda::Matr4r& matrix, char32_t ch)const;
-
-	const Glyph& findGlyph(char32_t c)const;
+	//load glyphs and texture from atlas cache entry, returns false if entry is empty or invalid
+	bool loadAtlas(const std::vector<std::uint8_t>& data);
+	
+	//serialize glyphs and texture image of fixed set font to atlas cache entry
+	std::vector<std::uint8_t> saveAtlas(const Image& texImg)const;
+	
+	const Texture2D& pageTex(unsigned page)const noexcept;
+	
+	//bounding box of the visible area of the glyph, i.e. glyph quad without distance field margins
+	morda::Rectr glyphBoundingBox(const Glyph& g)const noexcept;
+	
+	//returns nullptr if neither the glyph nor the replacement glyph is available
+	const Glyph* findGlyphOrNull(char32_t c)const;
+	
+	//returns loaded glyph, in dynamic mode the glyph is loaded if needed, returns nullptr if font has no such glyph
+	const Glyph* getGlyph(char32_t c)const;
+	
+	//dynamic mode only, rasterizes the glyph and puts it to the cache
+	const Glyph* loadGlyph(char32_t c)const;
+	
+	//dynamic mode only, caches the replacement glyph for the character which the font has no glyph for,
+	//so that the font face is not queried for it again, the glyph is empty if there is no replacement glyph either
+	const Glyph* loadMissingGlyph(char32_t c)const;
+	
+	//dynamic mode only, finds place for glyph image on one of the pages
+	unsigned allocGlyphPlace(kolme::Vec2ui dim, kolme::Vec2ui& pos)const;
+	
+	void uploadDirtyPages()const;
 };
 
 
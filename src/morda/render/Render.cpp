@@ -4,6 +4,44 @@
 
 #include "../config.hpp"
 
+#include "Shader.hpp"
+
+
+using namespace morda;
+
+
+Render::FrameStats Render::frameStats;
+
+
+
+void Render::flush(){
+	Shader::flushBatch();
+}
+
+
+
+void Render::countPrimitives(Mode_e mode, size_t numVertices)noexcept{
+	switch(mode){
+		case Mode_e::TRIANGLES:
+			frameStats.numPrimitives += numVertices / 3;
+			break;
+		case Mode_e::TRIANGLE_FAN:
+		case Mode_e::TRIANGLE_STRIP:
+			if(numVertices >= 3){
+				frameStats.numPrimitives += numVertices - 2;
+			}
+			break;
+		case Mode_e::LINE_LOOP:
+			if(numVertices >= 2){
+				frameStats.numPrimitives += numVertices;
+			}
+			break;
+		default:
+			ASSERT(false)
+			break;
+	}
+}
+
 
 
 #if M_MORDA_RENDER == M_MORDA_RENDER_OPENGL || M_MORDA_RENDER == M_MORDA_RENDER_OPENGLES
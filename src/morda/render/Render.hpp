@@ -57,8 +57,62 @@ public:
 			id(id),
 			data(data)
 		{}
+		
+		bool operator==(const InputID& i)const noexcept{
+			return this->id == i.id && this->data == i.data;
+		}
+		
+		bool operator!=(const InputID& i)const noexcept{
+			return !this->operator==(i);
+		}
+	};
+	
+	/**
+	 * @brief Rendering statistics.
+	 * Counters collected by the rendering layer, see getFrameStats().
+	 */
+	struct FrameStats{
+		/**
+		 * @brief Number of draw calls issued to the rendering API.
+		 */
+		size_t numDrawCalls = 0;
+		
+		/**
+		 * @brief Number of primitives (triangles or lines) submitted by shaders.
+		 */
+		size_t numPrimitives = 0;
 	};
 	
+	/**
+	 * @brief Get rendering statistics.
+	 * Statistics are accumulated since last call to resetFrameStats().
+	 * Morda::render() resets the statistics at the beginning of each frame.
+	 * @return Rendering statistics.
+	 */
+	static const FrameStats& getFrameStats()noexcept{
+		return frameStats;
+	}
+	
+	/**
+	 * @brief Reset rendering statistics.
+	 */
+	static void resetFrameStats()noexcept{
+		frameStats = FrameStats();
+	}
+	
+	/**
+	 * @brief Submit pending batched geometry.
+	 * Geometry rendered via shaders is accumulated into a batch which is submitted to
+	 * rendering API only when some rendering state changes. Call this function before
+	 * making any direct calls to underlying rendering API, e.g. when mixing GUI rendering with own OpenGL code.
+	 */
+	static void flush();
+	
+private:
+	static FrameStats frameStats;
+	
+	static void countPrimitives(Mode_e mode, size_t numVertices)noexcept;
+	
 	//=== functions to be used by Shader class internally
 private:
 	static void renderArrays(Mode_e mode, size_t numElements);
@@ -84,13 +138,13 @@ private:
 	
 	static void setUniform4f(InputID id, const utki::Buf<kolme::Vec4f> v);
 	
-	static void setVertexAttribArray(InputID id, const std::uint32_t* a);
+	static void setVertexAttribArray(InputID id, const utki::Buf<std::uint32_t> a);
 	
-	static void setVertexAttribArray(InputID id, const kolme::Vec4f* a);
+	static void setVertexAttribArray(InputID id, const utki::Buf<kolme::Vec4f> a);
 	
-	static void setVertexAttribArray(InputID id, const kolme::Vec3f* a);
+	static void setVertexAttribArray(InputID id, const utki::Buf<kolme::Vec3f> a);
 	
-	static void setVertexAttribArray(InputID id, const kolme::Vec2f* a);
+	static void setVertexAttribArray(InputID id, const utki::Buf<kolme::Vec2f> a);
 	//=== ~~~
 	
 	
@@ -179,10 +233,31 @@ public:
 	 */
 	static void setCullEnabled(bool enable);
 	
+	/**
+	 * @brief Re-read the cached rendering state from the rendering API.
+	 * Render keeps a copy of rendering state (viewport, scissor test, blending, bound shader program,
+	 * textures and framebuffer, face culling) to skip redundant state changes and to avoid querying
+	 * the rendering API in state getters. If the state is changed by direct calls to the underlying
+	 * rendering API, call this function afterwards to update the cached state.
+	 * Call flush() before making such direct calls.
+	 */
+	static void resetStateCache();
+	
+	/**
+	 * @brief Cross-check the cached rendering state against the rendering API.
+	 * Queries the actual state from the rendering API and compares it to the cached one.
+	 * Intended for debugging, as it is slow. In debug builds state getters perform such a check
+	 * for the values they return.
+	 * @throw morda::Exc if cached state does not match the actual one.
+	 */
+	static void checkStateCache();
+	
 	//=== functions to be used by Texture class
 private:
 	static std::unique_ptr<utki::Void> create2DTexture(kolme::Vec2ui dim, unsigned numChannels, const utki::Buf<std::uint8_t> data, TexFilter_e minFilter, TexFilter_e magFilter);
 	
+	static void update2DTexture(utki::Void& tex, kolme::Vec2ui pos, kolme::Vec2ui dim, unsigned numChannels, const utki::Buf<std::uint8_t> data);
+	
 	static void bindTexture(utki::Void& tex, unsigned unitNum);
 	
 	static bool isTextureBound(utki::Void& tex, unsigned unitNum);
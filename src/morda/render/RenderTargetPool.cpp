@@ -0,0 +1,156 @@
+#include "RenderTargetPool.hpp"
+
+#include <algorithm>
+
+#include <utki/debug.hpp>
+
+
+using namespace morda;
+
+
+
+namespace{
+
+size_t textureBytes(const Texture2D& tex){
+	return size_t(tex.dim().x) * size_t(tex.dim().y) * 4;
+}
+
+}
+
+
+
+kolme::Vec2ui RenderTargetPool::bucketDim(kolme::Vec2ui dim)noexcept{
+	for(unsigned i = 0; i != 2; ++i){
+		if(dim[i] == 0){
+			dim[i] = 1;
+		}
+		dim[i] = ((dim[i] + bucketGranularity_c - 1) / bucketGranularity_c) * bucketGranularity_c;
+	}
+	return dim;
+}
+
+
+
+Texture2D RenderTargetPool::acquireTexture(kolme::Vec2ui dim){
+	auto d = bucketDim(dim);
+	auto key = std::make_pair(d.x, d.y);
+
+	auto i = this->textures.find(key);
+	if(i != this->textures.end() && i->second.size() != 0){
+		Texture2D ret = std::move(i->second.back());
+		i->second.pop_back();
+
+		//remove most recent release record for this bucket
+		auto j = std::find(this->releaseOrder.rbegin(), this->releaseOrder.rend(), key);
+		ASSERT(j != this->releaseOrder.rend())
+		this->releaseOrder.erase(std::next(j).base());
+
+		ASSERT(this->stats_v.numTextures != 0)
+		--this->stats_v.numTextures;
+		this->stats_v.textureBytes -= textureBytes(ret);
+		++this->stats_v.hits;
+		return ret;
+	}
+
+	++this->stats_v.misses;
+
+	return Texture2D(d, 4, Render::TexFilter_e::NEAREST, Render::TexFilter_e::NEAREST);
+}
+
+
+
+void RenderTargetPool::releaseTexture(Texture2D&& tex){
+	if(!tex){
+		return;
+	}
+
+	auto d = tex.dim().to<unsigned>();
+	if(bucketDim(d) != d){
+		//not a pool texture, just free it
+		Texture2D t = std::move(tex);
+		return;
+	}
+
+	size_t bytes = textureBytes(tex);
+	if(bytes > this->maxTextureBytes_v){
+		Texture2D t = std::move(tex);
+		return;
+	}
+
+	this->trim(this->maxTextureBytes_v - bytes);
+
+	auto key = std::make_pair(d.x, d.y);
+	this->textures[key].push_back(std::move(tex));
+	this->releaseOrder.push_back(key);
+
+	++this->stats_v.numTextures;
+	this->stats_v.textureBytes += bytes;
+}
+
+
+
+void RenderTargetPool::trim(size_t maxBytes){
+	while(this->stats_v.textureBytes > maxBytes){
+		ASSERT(this->releaseOrder.size() != 0)
+		auto key = this->releaseOrder.front();
+		this->releaseOrder.pop_front();
+
+		auto i = this->textures.find(key);
+		ASSERT(i != this->textures.end())
+		ASSERT(i->second.size() != 0)
+
+		//oldest texture of the bucket is the first one
+		this->stats_v.textureBytes -= textureBytes(i->second.front());
+		--this->stats_v.numTextures;
+		i->second.erase(i->second.begin());
+
+		if(i->second.size() == 0){
+			this->textures.erase(i);
+		}
+	}
+}
+
+
+
+std::unique_ptr<FrameBuffer> RenderTargetPool::acquireFrameBuffer(){
+	if(this->frameBuffers.size() == 0){
+		return utki::makeUnique<FrameBuffer>();
+	}
+
+	auto ret = std::move(this->frameBuffers.back());
+	this->frameBuffers.pop_back();
+	this->stats_v.numFrameBuffers = this->frameBuffers.size();
+	return ret;
+}
+
+
+
+void RenderTargetPool::releaseFrameBuffer(std::unique_ptr<FrameBuffer> fb){
+	if(!fb){
+		return;
+	}
+
+	ASSERT(!fb->isBound())
+
+	this->frameBuffers.push_back(std::move(fb));
+	this->stats_v.numFrameBuffers = this->frameBuffers.size();
+}
+
+
+
+void RenderTargetPool::setMaxTextureBytes(size_t bytes){
+	this->maxTextureBytes_v = bytes;
+	this->trim(bytes);
+}
+
+
+
+void RenderTargetPool::clear(){
+	this->textures.clear();
+	this->releaseOrder.clear();
+	this->frameBuffers.clear();
+
+	this->stats_v.numTextures = 0;
+	this->stats_v.textureBytes = 0;
+	this->stats_v.numFrameBuffers = 0;
+}
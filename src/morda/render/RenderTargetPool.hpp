@@ -0,0 +1,154 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <kolme/Vector2.hpp>
+
+#include <utki/util.hpp>
+
+#include "FrameBuffer.hpp"
+#include "Texture2D.hpp"
+
+namespace morda{
+
+/**
+ * @brief Pool of render targets.
+ * Pool keeps framebuffer objects and textures for rendering to texture, so that they
+ * are re-used instead of being allocated and freed every time.
+ * Textures handed out by the pool have dimensions rounded up to the size bucket granularity,
+ * so a texture can be re-used for slightly different requested dimensions.
+ * All textures are RGBA with NEAREST filtering.
+ */
+class RenderTargetPool{
+public:
+	/**
+	 * @brief Granularity of texture size buckets, in pixels.
+	 */
+	constexpr static const unsigned bucketGranularity_c = 64;
+
+	/**
+	 * @brief Pool statistics.
+	 */
+	struct Stats{
+		/**
+		 * @brief Number of texture requests satisfied from the pool.
+		 */
+		size_t hits = 0;
+
+		/**
+		 * @brief Number of texture requests which needed a new texture allocation.
+		 */
+		size_t misses = 0;
+
+		/**
+		 * @brief Number of textures currently held by the pool.
+		 */
+		size_t numTextures = 0;
+
+		/**
+		 * @brief GPU memory used by textures currently held by the pool, in bytes.
+		 */
+		size_t textureBytes = 0;
+
+		/**
+		 * @brief Number of framebuffer objects currently held by the pool.
+		 */
+		size_t numFrameBuffers = 0;
+	};
+
+private:
+	Stats stats_v;
+
+	size_t maxTextureBytes_v = 32 * 1024 * 1024;
+
+	std::vector<std::unique_ptr<FrameBuffer>> frameBuffers;
+
+	//textures by bucket dimensions, most recently released go last
+	std::map<std::pair<unsigned, unsigned>, std::vector<Texture2D>> textures;
+
+	//order in which textures were released, for evicting oldest ones first
+	std::list<std::pair<unsigned, unsigned>> releaseOrder;
+
+	void trim(size_t maxBytes);
+
+public:
+	RenderTargetPool() = default;
+
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+	/**
+	 * @brief Round texture dimensions up to the size bucket.
+	 * @param dim - dimensions to round.
+	 * @return Dimensions of the bucket.
+	 */
+	static kolme::Vec2ui bucketDim(kolme::Vec2ui dim)noexcept;
+
+	/**
+	 * @brief Get texture from the pool.
+	 * If there is no free texture in the pool of required size bucket then new texture is allocated.
+	 * @param dim - minimal required dimensions of the texture.
+	 * @return Texture of dimensions of the size bucket corresponding to requested dimensions.
+	 */
+	Texture2D acquireTexture(kolme::Vec2ui dim);
+
+	/**
+	 * @brief Return texture to the pool.
+	 * Only textures with dimensions matching a size bucket are kept, others are freed.
+	 * If the pool grows over the memory limit then the least recently released textures are freed.
+	 * @param tex - texture to return to the pool.
+	 */
+	void releaseTexture(Texture2D&& tex);
+
+	/**
+	 * @brief Get framebuffer object from the pool.
+	 * @return Framebuffer object.
+	 */
+	std::unique_ptr<FrameBuffer> acquireFrameBuffer();
+
+	/**
+	 * @brief Return framebuffer object to the pool.
+	 * @param fb - framebuffer object to return. It should not be bound and have no attachments.
+	 */
+	void releaseFrameBuffer(std::unique_ptr<FrameBuffer> fb);
+
+	/**
+	 * @brief Set memory limit for textures held by the pool.
+	 * @param bytes - maximum number of bytes of GPU memory for the textures held by the pool.
+	 */
+	void setMaxTextureBytes(size_t bytes);
+
+	/**
+	 * @brief Get memory limit for textures held by the pool.
+	 * @return Maximum number of bytes of GPU memory for the textures held by the pool.
+	 */
+	size_t maxTextureBytes()const noexcept{
+		return this->maxTextureBytes_v;
+	}
+
+	/**
+	 * @brief Free all textures and framebuffer objects held by the pool.
+	 */
+	void clear();
+
+	/**
+	 * @brief Get pool statistics.
+	 * @return Pool statistics.
+	 */
+	const Stats& stats()const noexcept{
+		return this->stats_v;
+	}
+
+	/**
+	 * @brief Reset hit and miss counters.
+	 */
+	void resetCounters()noexcept{
+		this->stats_v.hits = 0;
+		this->stats_v.misses = 0;
+	}
+};
+
+}
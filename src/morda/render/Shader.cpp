@@ -1,5 +1,9 @@
 #include "Shader.hpp"
 
+#include <vector>
+
+#include <utki/debug.hpp>
+
 
 
 using namespace morda;
@@ -10,8 +14,249 @@ bool Shader::renderIsInProgress = false;
 
 
 
+namespace{
+
+//NOTE: 16 bit indices are used, so the batch cannot hold more vertices than that.
+const size_t maxBatchVertices_c = 0x10000;
+
+enum class AttrType_e{
+	NONE,
+	VEC2F,
+	VEC4F,
+	UINT32
+};
+
+struct{
+	Render::InputID posAttr = Render::InputID(0);
+	Render::InputID attr = Render::InputID(0);
+	AttrType_e attrType = AttrType_e::NONE;
+
+	std::vector<kolme::Vec4f> pos;
+
+	std::vector<kolme::Vec2f> vec2fAttr;
+	std::vector<kolme::Vec4f> vec4fAttr;
+	std::vector<std::uint32_t> uint32Attr;
+
+	std::vector<std::uint16_t> indices;
+
+	void clear(){
+		this->pos.clear();
+		this->vec2fAttr.clear();
+		this->vec4fAttr.clear();
+		this->uint32Attr.clear();
+		this->indices.clear();
+	}
+} batch;
+
+
+
+kolme::Vec4f toVec4(const kolme::Vec2f& v){
+	return kolme::Vec4f(v.x, v.y, 0, 1);
+}
+
+kolme::Vec4f toVec4(const kolme::Vec3f& v){
+	return kolme::Vec4f(v.x, v.y, v.z, 1);
+}
+
+
+
+AttrType_e attrType(const utki::Buf<kolme::Vec2f>){
+	return AttrType_e::VEC2F;
+}
+
+AttrType_e attrType(const utki::Buf<kolme::Vec4f>){
+	return AttrType_e::VEC4F;
+}
+
+AttrType_e attrType(const utki::Buf<std::uint32_t>){
+	return AttrType_e::UINT32;
+}
+
+
+
+void appendAttr(const utki::Buf<kolme::Vec2f> a){
+	batch.vec2fAttr.insert(batch.vec2fAttr.end(), a.begin(), a.end());
+}
+
+void appendAttr(const utki::Buf<kolme::Vec4f> a){
+	batch.vec4fAttr.insert(batch.vec4fAttr.end(), a.begin(), a.end());
+}
+
+void appendAttr(const utki::Buf<std::uint32_t> a){
+	batch.uint32Attr.insert(batch.uint32Attr.end(), a.begin(), a.end());
+}
+
+
+
+//Convert vertex indices of given rendering mode to list of triangles and append it to the batch.
+void appendIndices(Render::Mode_e mode, const utki::Buf<std::uint16_t> i, size_t numVertices, size_t first){
+	size_t n = i.size() == 0 ? numVertices : i.size();
+
+	auto index = [&i, first](size_t k) -> std::uint16_t{
+		return std::uint16_t(first + (i.size() == 0 ? k : i[k]));
+	};
+
+	switch(mode){
+		case Render::Mode_e::TRIANGLES:
+			for(size_t k = 0; k + 2 < n; k += 3){
+				batch.indices.push_back(index(k));
+				batch.indices.push_back(index(k + 1));
+				batch.indices.push_back(index(k + 2));
+			}
+			break;
+		case Render::Mode_e::TRIANGLE_FAN:
+			for(size_t k = 1; k + 1 < n; ++k){
+				batch.indices.push_back(index(0));
+				batch.indices.push_back(index(k));
+				batch.indices.push_back(index(k + 1));
+			}
+			break;
+		case Render::Mode_e::TRIANGLE_STRIP:
+			//keep the winding of odd triangles same as of even ones, as face culling may be enabled
+			for(size_t k = 0; k + 2 < n; ++k){
+				if(k % 2 == 0){
+					batch.indices.push_back(index(k));
+					batch.indices.push_back(index(k + 1));
+				}else{
+					batch.indices.push_back(index(k + 1));
+					batch.indices.push_back(index(k));
+				}
+				batch.indices.push_back(index(k + 2));
+			}
+			break;
+		default:
+			ASSERT(false)
+			break;
+	}
+}
+
+}//~namespace
+
+
 
 Shader::Shader(const char* vertexShaderCode, const char* fragmentShaderCode) :
 		program(Render::compileShader(vertexShaderCode, fragmentShaderCode)),
 		matrixUniform(this->getUniform("matrix"))
-{}
+{
+	this->matrix.identity();
+}
+
+
+
+Shader::~Shader()noexcept{
+	if(boundShader == this){
+		flushBatch();
+		boundShader = nullptr;
+		renderIsInProgress = false;
+	}
+}
+
+
+
+void Shader::flushBatch(){
+	if(batch.pos.size() == 0){
+		return;
+	}
+
+	if(batch.indices.size() != 0){
+		ASSERT(boundShader)
+
+		Render::setUniformMatrix4f(boundShader->matrixUniform, kolme::Matr4f().identity());
+
+		Render::setVertexAttribArray(batch.posAttr, utki::wrapBuf(batch.pos));
+
+		switch(batch.attrType){
+			case AttrType_e::VEC2F:
+				ASSERT(batch.vec2fAttr.size() == batch.pos.size())
+				Render::setVertexAttribArray(batch.attr, utki::wrapBuf(batch.vec2fAttr));
+				break;
+			case AttrType_e::VEC4F:
+				ASSERT(batch.vec4fAttr.size() == batch.pos.size())
+				Render::setVertexAttribArray(batch.attr, utki::wrapBuf(batch.vec4fAttr));
+				break;
+			case AttrType_e::UINT32:
+				ASSERT(batch.uint32Attr.size() == batch.pos.size())
+				Render::setVertexAttribArray(batch.attr, utki::wrapBuf(batch.uint32Attr));
+				break;
+			default:
+				break;
+		}
+
+		Render::renderElements(Render::Mode_e::TRIANGLES, utki::wrapBuf(batch.indices));
+	}
+
+	batch.clear();
+}
+
+
+
+template <class V, class A> void Shader::renderBatched(
+		Render::Mode_e mode,
+		const utki::Buf<std::uint16_t> i,
+		Render::InputID posAttr,
+		const utki::Buf<V> p,
+		Render::InputID attr,
+		const utki::Buf<A> a
+	)
+{
+	ASSERT(a.size() == 0 || a.size() == p.size())
+
+	AttrType_e type = a.size() == 0 ? AttrType_e::NONE : attrType(a);
+
+	if(mode == Render::Mode_e::LINE_LOOP || p.size() > maxBatchVertices_c){
+		//cannot be batched, render right away
+		this->setVertexAttribArray(posAttr, p);
+		if(type != AttrType_e::NONE){
+			this->setVertexAttribArray(attr, a);
+		}
+		if(i.size() == 0){
+			this->renderArrays(mode, p.size());
+		}else{
+			this->renderElements(mode, i);
+		}
+		return;
+	}
+
+	this->bind();
+
+	if(batch.pos.size() != 0){
+		if(batch.posAttr != posAttr || batch.attr != attr || batch.attrType != type || batch.pos.size() + p.size() > maxBatchVertices_c){
+			flushBatch();
+		}
+	}
+
+	if(batch.pos.size() == 0){
+		batch.posAttr = posAttr;
+		batch.attr = attr;
+		batch.attrType = type;
+	}
+
+	size_t first = batch.pos.size();
+
+	for(auto& v : p){
+		batch.pos.push_back(this->matrix * toVec4(v));
+	}
+
+	if(type != AttrType_e::NONE){
+		appendAttr(a);
+	}
+
+#ifdef DEBUG
+	for(auto& k : i){
+		ASSERT_INFO(k < p.size(), "vertex index is out of range: k = " << k << ", p.size() = " << p.size())
+	}
+#endif
+
+	appendIndices(mode, i, p.size(), first);
+
+	Render::countPrimitives(mode, i.size() == 0 ? p.size() : i.size());
+
+	renderIsInProgress = false;
+}
+
+template void Shader::renderBatched(Render::Mode_e, const utki::Buf<std::uint16_t>, Render::InputID, const utki::Buf<kolme::Vec2f>, Render::InputID, const utki::Buf<kolme::Vec2f>);
+template void Shader::renderBatched(Render::Mode_e, const utki::Buf<std::uint16_t>, Render::InputID, const utki::Buf<kolme::Vec2f>, Render::InputID, const utki::Buf<kolme::Vec4f>);
+template void Shader::renderBatched(Render::Mode_e, const utki::Buf<std::uint16_t>, Render::InputID, const utki::Buf<kolme::Vec2f>, Render::InputID, const utki::Buf<std::uint32_t>);
+template void Shader::renderBatched(Render::Mode_e, const utki::Buf<std::uint16_t>, Render::InputID, const utki::Buf<kolme::Vec3f>, Render::InputID, const utki::Buf<kolme::Vec2f>);
+template void Shader::renderBatched(Render::Mode_e, const utki::Buf<std::uint16_t>, Render::InputID, const utki::Buf<kolme::Vec3f>, Render::InputID, const utki::Buf<kolme::Vec4f>);
+template void Shader::renderBatched(Render::Mode_e, const utki::Buf<std::uint16_t>, Render::InputID, const utki::Buf<kolme::Vec3f>, Render::InputID, const utki::Buf<std::uint32_t>);
@@ -33,6 +33,20 @@ class Shader{
 
 	const Render::InputID matrixUniform;
 	
+	//Matrix is kept on CPU side. Batched geometry is transformed with it when added to the batch,
+	//non-batched geometry gets it as the matrix uniform value.
+	kolme::Matr4f matrix;
+	
+	//Submit geometry accumulated by batched render calls of the bound shader.
+	static void flushBatch();
+	
+protected:
+	/**
+	 * @brief Bind this shader.
+	 * Starts the render sequence of the shader, i.e. one of the render() methods
+	 * or renderNothing() is supposed to be called after that.
+	 * @throw morda::Exc if another shader is bound and its render sequence is not terminated.
+	 */
 	void bind(){
 		if(this == boundShader){
 			return;
@@ -42,14 +56,15 @@ class Shader{
 			throw morda::Exc("Shader: cannot bind shader because another shader is bound and one of its render() methods was not called");
 		}
 		
+		flushBatch();
+		
 		renderIsInProgress = true;
 		
 		Render::bindShader(*this->program);
 		boundShader = this;
 	}
 	
-	
-protected:
+
 	/**
 	 * @brief Find shader attribute.
 	 * @param n - name of the attribute to look for.
@@ -84,7 +99,10 @@ protected:
 	 */
 	void renderArrays(Render::Mode_e mode, size_t numElements){
 		this->bind();
+		flushBatch();
+		Render::setUniformMatrix4f(this->matrixUniform, this->matrix);
 		Render::renderArrays(mode, numElements);
+		Render::countPrimitives(mode, numElements);
 		this->renderIsInProgress = false;
 	}
 	
@@ -95,10 +113,47 @@ protected:
 	 */
 	void renderElements(Render::Mode_e mode, const utki::Buf<std::uint16_t> i){
 		this->bind();
+		flushBatch();
+		Render::setUniformMatrix4f(this->matrixUniform, this->matrix);
 		Render::renderElements(mode, i);
+		Render::countPrimitives(mode, i.size());
 		this->renderIsInProgress = false;
 	}
 	
+	/**
+	 * @brief Render vertices through the batching layer.
+	 * Vertex positions are transformed by the shader matrix on CPU side and, together with the
+	 * additional vertex attribute, are appended to the batch of geometry. The batch is submitted
+	 * to rendering API in a single draw call when the shader or rendering state changes, see Render::flush().
+	 * Geometry which cannot be batched (e.g. LINE_LOOP mode) is rendered right away.
+	 * @param mode - rendering mode of vertex data.
+	 * @param i - vertex indices, if empty then vertices are rendered in order.
+	 * @param posAttr - ID of the vertex position attribute.
+	 * @param p - vertex positions.
+	 * @param attr - ID of the additional vertex attribute.
+	 * @param a - values of the additional vertex attribute, should be of same size as 'p'.
+	 */
+	template <class V, class A> void renderBatched(
+			Render::Mode_e mode,
+			const utki::Buf<std::uint16_t> i,
+			Render::InputID posAttr,
+			const utki::Buf<V> p,
+			Render::InputID attr,
+			const utki::Buf<A> a
+		);
+	
+	/**
+	 * @brief Render vertices through the batching layer.
+	 * Same as the other renderBatched() method, but for shaders without additional vertex attribute.
+	 * @param mode - rendering mode of vertex data.
+	 * @param i - vertex indices, if empty then vertices are rendered in order.
+	 * @param posAttr - ID of the vertex position attribute.
+	 * @param p - vertex positions.
+	 */
+	template <class V> void renderBatched(Render::Mode_e mode, const utki::Buf<std::uint16_t> i, Render::InputID posAttr, const utki::Buf<V> p){
+		this->renderBatched(mode, i, posAttr, p, posAttr, utki::Buf<kolme::Vec2f>(nullptr, 0));
+	}
+	
 	/**
 	 * @brief Set value of 4x4 matrix shader uniform.
 	 * @param id - ID of the unifor to set the value of.
@@ -106,47 +161,56 @@ protected:
 	 */
 	void setUniformMatrix4f(Render::InputID id, const kolme::Matr4f& m){
 		this->bind();
+		flushBatch();
 		Render::setUniformMatrix4f(id, m);
 	}
 	
 	void setUniform1i(Render::InputID id, int i){
 		this->bind();
+		flushBatch();
 		Render::setUniform1i(id, i);
 	}
 	
 	void setUniform2f(Render::InputID id, kolme::Vec2f v){
 		this->bind();
+		flushBatch();
 		Render::setUniform2f(id, v);
 	}
 	
 	void setUniform4f(Render::InputID id, float x, float y, float z, float a){
 		this->bind();
+		flushBatch();
 		Render::setUniform4f(id, x, y, z, a);
 	}
 	
 	void setUniform4f(Render::InputID id, const utki::Buf<kolme::Vec4f> v){
 		this->bind();
+		flushBatch();
 		Render::setUniform4f(id, v);
 	}
 	
 	void setVertexAttribArray(Render::InputID id, const utki::Buf<std::uint32_t> a){
 		this->bind();
-		Render::setVertexAttribArray(id, &*a.begin());
+		flushBatch();
+		Render::setVertexAttribArray(id, a);
 	}
 	
 	void setVertexAttribArray(Render::InputID id, const utki::Buf<kolme::Vec4f> a){
 		this->bind();
-		Render::setVertexAttribArray(id, &*a.begin());
+		flushBatch();
+		Render::setVertexAttribArray(id, a);
 	}
 	
 	void setVertexAttribArray(Render::InputID id, const utki::Buf<kolme::Vec3f> a){
 		this->bind();
-		Render::setVertexAttribArray(id, &*a.begin());
+		flushBatch();
+		Render::setVertexAttribArray(id, a);
 	}
 	
 	void setVertexAttribArray(Render::InputID id, const utki::Buf<kolme::Vec2f> a){
 		this->bind();
-		Render::setVertexAttribArray(id, &*a.begin());
+		flushBatch();
+		Render::setVertexAttribArray(id, a);
 	}
 public:
 	/**
@@ -161,14 +225,15 @@ public:
 		renderIsInProgress = false;
 	}
 	
-	virtual ~Shader()noexcept{}
+	virtual ~Shader()noexcept;
 	
 	/**
 	 * @brief Set value of the matrix uniform.
 	 * @param m - value to set as a matrix uniform of the shader.
 	 */
 	void setMatrix(const kolme::Matr4f &m){
-		this->setUniformMatrix4f(this->matrixUniform, m);
+		this->bind();
+		this->matrix = m;
 	}
 };
 
@@ -10,6 +10,7 @@ using namespace morda;
 
 void Texture2D::Constructor(kolme::Vec2ui d, unsigned numChannels, const utki::Buf<std::uint8_t> data, Render::TexFilter_e minFilter, Render::TexFilter_e magFilter) {
 	this->dim_v = d.to<real>();
+	this->bytes_v = size_t(d.x) * size_t(d.y) * size_t(numChannels);
 
 	this->tex = Render::create2DTexture(d, numChannels, data, minFilter, magFilter);
 }
@@ -31,3 +32,16 @@ Texture2D::Texture2D(unsigned width, std::vector<std::uint32_t> rgbaPixels, Rend
 			magFilter
 		);
 }
+
+
+
+void Texture2D::update(kolme::Vec2ui pos, const Image& image){
+	ASSERT(this->tex)
+	ASSERT(pos.x + image.dim().x <= this->dim().x && pos.y + image.dim().y <= this->dim().y)
+	
+	if(image.dim().x == 0 || image.dim().y == 0){
+		return;
+	}
+	
+	Render::update2DTexture(*this->tex, pos, image.dim(), image.numChannels(), image.buf());
+}
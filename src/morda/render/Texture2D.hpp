@@ -24,13 +24,30 @@ class Texture2D{
 
 	Vec2r dim_v;
 
+	size_t bytes_v = 0;
+
 	void Constructor(kolme::Vec2ui d, unsigned numChannels, const utki::Buf<std::uint8_t> data, Render::TexFilter_e minFilter, Render::TexFilter_e magFilter);
 public:
 	Texture2D(const Texture2D& tex) = delete;
 	Texture2D& operator=(const Texture2D& tex) = delete;
 	
-	Texture2D(Texture2D&& tex) = default;
-	Texture2D& operator=(Texture2D&&) = default;
+	//moved-from texture does not own GPU memory anymore, so it should not report its size
+	Texture2D(Texture2D&& tex) :
+			tex(std::move(tex.tex)),
+			dim_v(tex.dim_v),
+			bytes_v(tex.bytes_v)
+	{
+		tex.bytes_v = 0;
+	}
+	
+	Texture2D& operator=(Texture2D&& tex){
+		this->tex = std::move(tex.tex);
+		this->dim_v = tex.dim_v;
+		auto bytes = tex.bytes_v;
+		tex.bytes_v = 0;
+		this->bytes_v = bytes;
+		return *this;
+	}
 	
 	/**
 	 * @brief Create texture from raster image.
@@ -75,6 +92,16 @@ public:
 		Render::bindTexture(*this->tex, texUnitNum);
 	}
 	
+	/**
+	 * @brief Update part of the texture.
+	 * Replaces the texels of a rectangular area of the texture with the pixels of the image.
+	 * Number of channels of the image should be same as of the texture.
+	 * Note, that the texture is bound to 0th texture unit as a result of this operation.
+	 * @param pos - position of the area on the texture.
+	 * @param image - image to put to the texture. It should fit the texture.
+	 */
+	void update(kolme::Vec2ui pos, const Image& image);
+	
 	/**
 	 * @brief Check if the texture is currently bound.
 	 * @param texUnitNum - number of the texture unit to check.
@@ -93,6 +120,14 @@ public:
 		return this->dim_v;
 	}
 
+	/**
+	 * @brief Get GPU memory used by the texture.
+	 * @return Number of bytes of texture data.
+	 */
+	size_t bytes()const noexcept{
+		return this->bytes_v;
+	}
+
 	/**
 	 * @brief Check if this texture object is initialized (not empty).
 	 * @return true if this texture object is initialized (not empty).
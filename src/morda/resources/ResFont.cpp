@@ -12,18 +12,19 @@ using namespace morda;
 
 
 
-ResFont::ResFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline) :
-		f(fi, chars, fontSize, outline)
+ResFont::ResFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline, bool sdf) :
+		f(fi, chars, fontSize, outline, sdf)
 {}
 
 
 
-std::shared_ptr<ResFont> ResFont::load(const stob::Node& chain, const papki::File& fi){
-	//read chars attribute
-	auto wideChars = unikod::toUtf32(chain.side("chars").up().value());
+ResFont::ResFont(const papki::File& fi, unsigned fontSize, unsigned outline, size_t maxCacheBytes) :
+		f(fi, fontSize, outline, maxCacheBytes)
+{}
+
 
-	ASSERT(wideChars.size() > 0)
 
+std::shared_ptr<ResFont> ResFont::load(const stob::Node& chain, const papki::File& fi){
 	//read size attribute
 	unsigned fontSize;
 	if(auto sizeProp = chain.childOfThisOrNext("size")){
@@ -42,6 +43,27 @@ std::shared_ptr<ResFont> ResFont::load(const stob::Node& chain, const papki::Fil
 
 	fi.setPath(chain.side("file").up().value());
 
-	return utki::makeShared<ResFont>(fi, wideChars, fontSize, outline);
+	//read chars attribute, if there is no list of chars then the font is dynamic
+	if(auto charsProp = chain.childOfThisOrNext("chars")){
+		auto wideChars = unikod::toUtf32(charsProp->value());
+
+		ASSERT(wideChars.size() > 0)
+		
+		bool sdf = false;
+		if(auto sdfProp = chain.childOfThisOrNext("sdf")){
+			sdf = sdfProp->asBool();
+		}
+		
+		return utki::makeShared<ResFont>(fi, wideChars, fontSize, outline, sdf);
+	}
+	
+	size_t maxCacheBytes;
+	if(auto cacheSizeProp = chain.childOfThisOrNext("cacheSize")){
+		maxCacheBytes = size_t(cacheSizeProp->asUint32()) * 1024;
+	}else{
+		maxCacheBytes = TexFont::defaultMaxCacheBytes_c;
+	}
+	
+	return utki::makeShared<ResFont>(fi, fontSize, outline, maxCacheBytes);
 }
 
@@ -21,8 +21,13 @@ namespace morda{
  * 
  * @param file - file to load the font from, TrueType ttf file.
  * @param chars - list of all chars for which the glyphs should be created.
+ *                If omitted, the font is dynamic, i.e. glyphs are created on demand for any character.
  * @param size - size of glyphs, in length units, i.e.: no unit(pixels), pt, mm.
  * @param outline - thickness of the outline in length units.
+ * @param cacheSize - only for dynamic fonts, memory limit of the glyph cache, in kilobytes.
+ * @param sdf - only for fonts with list of chars, render glyphs from signed distance field atlas, true or false.
+ *              Distance field atlas is shared by all fonts loaded from the same file with the same list of chars,
+ *              regardless of their size and outline. Default value is false.
  * 
  * Example:
  * @code
@@ -32,6 +37,20 @@ namespace morda{
  *     size {12pt}
  *     outline {0}
  * }
+ * 
+ * fnt_big_outlined{
+ *     file {Vera.ttf}
+ *     chars {" 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz.,:;?!()_*+-|\\/"}
+ *     size {24pt}
+ *     outline {2}
+ *     sdf {true}
+ * }
+ * 
+ * fnt_user_input{
+ *     file {Vera.ttf}
+ *     size {12pt}
+ *     cacheSize {4096}
+ * }
  * @endcode
  */
 class ResFont : public morda::Resource{
@@ -40,7 +59,13 @@ class ResFont : public morda::Resource{
 	morda::TexFont f;
 
 public:
-	ResFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline);
+	ResFont(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned outline, bool sdf = false);
+	
+	/**
+	 * @brief Create dynamic font resource.
+	 * See TexFont for details.
+	 */
+	ResFont(const papki::File& fi, unsigned fontSize, unsigned outline, size_t maxCacheBytes);
 
 	~ResFont()noexcept{}
 
@@ -52,6 +77,10 @@ public:
 		return this->f;
 	}
 	
+	size_t memoryUsage()const noexcept override{
+		return this->f.cacheBytes();
+	}
+	
 private:
 	static std::shared_ptr<ResFont> load(const stob::Node& chain, const papki::File &fi);
 };
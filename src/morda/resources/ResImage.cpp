@@ -1,4 +1,5 @@
 #include <memory>
+#include <algorithm>
 
 #include <svgren/render.hpp>
 
@@ -13,7 +14,10 @@
 
 #include "../Morda.hpp"
 
+#include "../widgets/core/Widget.hpp"
+
 #include "../util/util.hpp"
+#include "../util/Image.hpp"
 
 #include "../shaders/PosTexShader.hpp"
 
@@ -89,16 +93,32 @@ public:
 		return this->tex_v.dim();
 	}
 	
+	size_t memoryUsage()const noexcept override{
+		return this->tex_v.bytes();
+	}
+	
 	static std::shared_ptr<ResRasterImage> load(const papki::File& fi){
 		return utki::makeShared<ResRasterImage>(loadTexture(fi));
 	}
+	
+	static Resource::T_Finisher decode(const papki::File& fi){
+		auto image = std::make_shared<Image>(fi);
+		image->flipVertical();
+		return [image](){
+			return utki::makeShared<ResRasterImage>(Texture2D(*image));
+		};
+	}
 };
 
 class ResSvgImage : public ResImage{
 	std::unique_ptr<svgdom::SvgElement> dom;
+	
+	//hash of SVG file contents, used for making raster cache keys, 0 if raster cache is not used
+	std::uint64_t fileHash;
 public:
-	ResSvgImage(decltype(dom) dom) :
-			dom(std::move(dom))
+	ResSvgImage(decltype(dom) dom, std::uint64_t fileHash = 0) :
+			dom(std::move(dom)),
+			fileHash(fileHash)
 	{}
 	
 	Vec2r dim(real dpi)const noexcept override{
@@ -108,36 +128,255 @@ public:
 			);
 	}
 	
-	class SvgTexture : public TexQuadTexture{
+	size_t memoryUsage()const noexcept override{
+		//count rasterizations which are in use, textures of other sizes drawn while rasterizing are counted by their own sizes
+		size_t ret = 0;
+		for(auto& e : this->cache){
+			if(auto p = e.second.lock()){
+				if(p->ready){
+					ret += p->tex->bytes();
+				}
+			}
+		}
+		return ret;
+	}
+	
+	class SvgTexture : public ResImage::QuadTexture{
+		friend class ResSvgImage;
+		
 		std::weak_ptr<const ResSvgImage> parent;
+		
+		//texture rasterized for the dimensions of this quad texture, or, while those are being
+		//rasterized in background, the texture of the nearest dimensions, which is drawn scaled
+		std::shared_ptr<const Texture2D> tex;
+		
+		//true if the texture is rasterized for the dimensions of this quad texture
+		bool ready;
+		
+		//widgets to invalidate when the texture of requested dimensions is ready
+		mutable std::vector<std::weak_ptr<Widget>> users;
 	public:
-		SvgTexture(std::shared_ptr<const ResSvgImage> parent, Texture2D&& tex) :
-				TexQuadTexture(std::move(tex)),
-				parent(parent)
+		SvgTexture(std::shared_ptr<const ResSvgImage> parent, Vec2r dim, std::shared_ptr<const Texture2D> tex, bool ready) :
+				ResImage::QuadTexture(dim),
+				parent(parent),
+				tex(std::move(tex)),
+				ready(ready)
 		{}
 
 		~SvgTexture()noexcept{
 			if(auto p = this->parent.lock()){
-				kolme::Vec2ui d = this->tex_v.dim().to<unsigned>();
+				kolme::Vec2ui d = this->dim().to<unsigned>();
 				p->cache.erase(std::make_tuple(d.x, d.y));
 			}
 		}
+		
+		void render(PosTexShader& s, const std::array<kolme::Vec2f, 4>& texCoords) const override{
+			this->tex->bind();
+
+			s.render(utki::wrapBuf(PosShader::quad01Fan), utki::wrapBuf(texCoords));
+		}
+		
+		void addUser(std::weak_ptr<Widget> w)const override{
+			if(this->ready){
+				return;
+			}
+			this->users.push_back(std::move(w));
+		}
+		
+		void setReady(std::shared_ptr<const Texture2D> tex){
+			this->tex = std::move(tex);
+			this->ready = true;
+			
+			for(auto& u : this->users){
+				if(auto w = u.lock()){
+					w->invalidate();
+				}
+			}
+			this->users.clear();
+		}
 	};
 	
 	std::shared_ptr<const QuadTexture> get(Vec2r forDim)const override{
 		unsigned imWidth = unsigned(forDim.x);
 		unsigned imHeight = unsigned(forDim.y);
+		
+		auto key = std::make_tuple(imWidth, imHeight);
 
 		{//check if in cache
-			auto i = this->cache.find(std::make_tuple(imWidth, imHeight));
+			auto i = this->cache.find(key);
 			if(i != this->cache.end()){
 				if(auto p = i->second.lock()){
 					return p;
 				}
 			}
 		}
+		
+		//If some of the dimensions is 0, then actual dimensions are only known after rasterization.
+		//Otherwise, if there is a texture of other dimensions, then draw it scaled until the requested ones are rasterized.
+		if(imWidth != 0 && imHeight != 0){
+			if(auto nearest = this->findNearestReady(imWidth, imHeight)){
+				auto img = utki::makeShared<SvgTexture>(this->sharedFromThis(this), forDim, nearest->tex, false);
+				
+				this->cache[key] = img;
+				
+				this->requestRasterization(key);
+				
+				return img;
+			}
+		}
 
-		auto pixels = svgren::render(*this->dom, imWidth, imHeight, morda::Morda::inst().units.dpi());
+		auto pixels = this->rasterize(imWidth, imHeight, morda::Morda::inst().units.dpi());
+		
+		auto img = utki::makeShared<SvgTexture>(
+				this->sharedFromThis(this),
+				Vec2r(real(imWidth), real(imHeight)),
+				std::make_shared<Texture2D>(imWidth, std::move(pixels)),
+				true
+			);
+
+		this->cache[std::make_tuple(imWidth, imHeight)] = img;
+
+		return img;
+	}
+	
+	mutable std::map<std::tuple<unsigned, unsigned>, std::weak_ptr<SvgTexture>> cache;
+	
+	//dimensions waiting for background rasterization, the most recently requested ones go last
+	mutable std::vector<std::tuple<unsigned, unsigned>> pendingRasterizations;
+	
+	//true while rasterization is being done on a worker thread
+	mutable bool rasterizing = false;
+	
+	std::shared_ptr<SvgTexture> findNearestReady(unsigned width, unsigned height)const{
+		std::shared_ptr<SvgTexture> ret;
+		unsigned minDistance = 0;
+		for(auto& e : this->cache){
+			auto p = e.second.lock();
+			if(!p || !p->ready){
+				continue;
+			}
+			unsigned dx = std::get<0>(e.first) > width ? std::get<0>(e.first) - width : width - std::get<0>(e.first);
+			unsigned dy = std::get<1>(e.first) > height ? std::get<1>(e.first) - height : height - std::get<1>(e.first);
+			if(!ret || dx + dy < minDistance){
+				ret = std::move(p);
+				minDistance = dx + dy;
+			}
+		}
+		return ret;
+	}
+	
+	void requestRasterization(const std::tuple<unsigned, unsigned>& dim)const{
+		this->pendingRasterizations.erase(
+				std::remove(this->pendingRasterizations.begin(), this->pendingRasterizations.end(), dim),
+				this->pendingRasterizations.end()
+			);
+		this->pendingRasterizations.push_back(dim);
+		
+		if(!this->rasterizing){
+			this->rasterizeNext();
+		}
+	}
+	
+	//Start background rasterization of the most recently requested dimensions which are still in use.
+	//Dimensions which are not used anymore, like intermediate sizes during live resizing of a window, are dropped.
+	void rasterizeNext()const{
+		while(this->pendingRasterizations.size() != 0){
+			auto dim = this->pendingRasterizations.back();
+			this->pendingRasterizations.pop_back();
+			
+			auto i = this->cache.find(dim);
+			if(i == this->cache.end()){
+				continue;
+			}
+			auto p = i->second.lock();
+			if(!p || p->ready){
+				continue;
+			}
+			
+			this->rasterizing = true;
+			
+			auto self = this->sharedFromThis(this);
+			real dpi = morda::Morda::inst().units.dpi();
+			
+			morda::Morda::inst().workers.post_ts([self, dim, dpi](){
+				std::shared_ptr<std::vector<std::uint32_t>> pixels;
+				try{
+					unsigned w = std::get<0>(dim);
+					unsigned h = std::get<1>(dim);
+					pixels = std::make_shared<std::vector<std::uint32_t>>(self->rasterize(w, h, dpi));
+				}catch(std::exception& e){
+					TRACE(<< "ResSvgImage: background rasterization failed: " << e.what() << std::endl)
+				}catch(...){
+					TRACE(<< "ResSvgImage: background rasterization failed" << std::endl)
+				}
+				
+				morda::Morda::inst().postToUiThread_ts([self, dim, pixels](){
+					self->rasterizing = false;
+					
+					if(pixels){
+						auto i = self->cache.find(dim);
+						if(i != self->cache.end()){
+							if(auto p = i->second.lock()){
+								p->setReady(std::make_shared<Texture2D>(std::get<0>(dim), std::move(*pixels)));
+							}
+						}
+					}
+					
+					self->rasterizeNext();
+				});
+			});
+			return;
+		}
+	}
+	
+	//header of raster cache entry, it is followed by the pixels, flipped vertically
+	struct RasterCacheHeader{
+		std::uint32_t magic;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t reserved;//keeps pixels 16 byte aligned
+	};
+	
+	constexpr static const std::uint32_t rasterCacheMagic_c = 0x4d535231;//"MSR1"
+	
+	std::string rasterCacheKey(unsigned width, unsigned height, real dpi)const{
+		struct{
+			std::uint32_t magic;
+			std::uint32_t width;
+			std::uint32_t height;
+			float dpi;
+		} params = {rasterCacheMagic_c, width, height, float(dpi)};
+		
+		auto h = DiskCache::hash(utki::wrapBuf(reinterpret_cast<const std::uint8_t*>(&this->fileHash), sizeof(this->fileHash)));
+		h = DiskCache::hash(utki::wrapBuf(reinterpret_cast<const std::uint8_t*>(&params), sizeof(params)), h);
+		return std::string("svg_") + DiskCache::hashToString(h);
+	}
+	
+	//Rasterize SVG and flip pixels vertically, or load the result from raster cache. Can be called from any thread.
+	std::vector<std::uint32_t> rasterize(unsigned& imWidth, unsigned& imHeight, real dpi)const{
+		auto& rasterCache = morda::Morda::inst().svgRasterCache;
+		
+		std::string cacheKey;
+		if(this->fileHash != 0 && rasterCache.isEnabled()){
+			cacheKey = this->rasterCacheKey(imWidth, imHeight, dpi);
+			
+			auto data = rasterCache.load(cacheKey);
+			if(data.size() >= sizeof(RasterCacheHeader)){
+				RasterCacheHeader h;
+				memcpy(&h, &*data.begin(), sizeof(h));
+				if(h.magic == rasterCacheMagic_c && data.size() == sizeof(h) + size_t(h.width) * size_t(h.height) * sizeof(std::uint32_t)){
+					imWidth = h.width;
+					imHeight = h.height;
+					std::vector<std::uint32_t> pixels(size_t(h.width) * size_t(h.height));
+					if(pixels.size() != 0){
+						memcpy(&*pixels.begin(), &*data.begin() + sizeof(h), pixels.size() * sizeof(pixels[0]));
+					}
+					return pixels;
+				}
+			}
+		}
+		
+		auto pixels = svgren::render(*this->dom, imWidth, imHeight, dpi);
 		ASSERT_INFO(imWidth * imHeight == pixels.size(), "imWidth = " << imWidth << " imHeight = " << imHeight << " pixels.size() = " << pixels.size())
 		
 		//flip pixels vertically
@@ -154,17 +393,45 @@ public:
 			}
 		}
 		
-		auto img = utki::makeShared<SvgTexture>(this->sharedFromThis(this), Texture2D(imWidth, pixels));
-
-		this->cache[std::make_tuple(imWidth, imHeight)] = img;
-
-		return img;
+		if(cacheKey.size() != 0){
+			RasterCacheHeader h = {rasterCacheMagic_c, imWidth, imHeight, 0};
+			std::vector<std::uint8_t> data(sizeof(h) + pixels.size() * sizeof(pixels[0]));
+			memcpy(&*data.begin(), &h, sizeof(h));
+			if(pixels.size() != 0){
+				memcpy(&*data.begin() + sizeof(h), &*pixels.begin(), pixels.size() * sizeof(pixels[0]));
+			}
+			rasterCache.store(cacheKey, utki::wrapBuf(data));
+		}
+		
+		return pixels;
 	}
 	
-	mutable std::map<std::tuple<unsigned, unsigned>, std::weak_ptr<QuadTexture>> cache;
+	//Calculate hash of SVG file contents if raster cache is enabled, otherwise return 0.
+	static std::uint64_t calcFileHash(const papki::File& fi){
+		if(!morda::Morda::inst().svgRasterCache.isEnabled()){
+			return 0;
+		}
+		auto data = fi.loadWholeFileIntoMemory();
+		auto h = DiskCache::hash(utki::wrapBuf(data));
+		if(h == 0){
+			h = 1;//0 means no hash
+		}
+		return h;
+	}
 	
 	static std::shared_ptr<ResSvgImage> load(const papki::File& fi){
-		return utki::makeShared<ResSvgImage>(svgdom::load(fi));
+		auto fileHash = calcFileHash(fi);
+		return utki::makeShared<ResSvgImage>(svgdom::load(fi), fileHash);
+	}
+	
+	static Resource::T_Finisher decode(const papki::File& fi){
+		auto fileHash = calcFileHash(fi);
+		
+		//std::function needs copyable functor, so hold the DOM via shared_ptr
+		auto dom = std::make_shared<std::unique_ptr<svgdom::SvgElement>>(svgdom::load(fi));
+		return [dom, fileHash](){
+			return utki::makeShared<ResSvgImage>(std::move(*dom), fileHash);
+		};
 	}	
 };
 }
@@ -189,3 +456,19 @@ std::shared_ptr<ResImage> ResImage::load(const papki::File& fi) {
 		return ResRasterImage::load(fi);
 	}
 }
+
+Resource::T_Finisher ResImage::decode(const stob::Node& chain, const papki::File& fi) {
+	if(auto f = chain.thisOrNext("file").node()){
+		if(auto fn = f->child()){
+			fi.setPath(fn->value());
+			if(fi.ext().compare("svg") == 0){
+				return ResSvgImage::decode(fi);
+			}else{
+				return ResRasterImage::decode(fi);
+			}
+		}
+	}
+	
+	//atlas image refers to texture resource, so it is loaded on UI thread
+	return nullptr;
+}
@@ -14,6 +14,8 @@
 
 namespace morda{
 
+class Widget;
+
 /**
  * @brief Base image resource class.
  * 
@@ -64,6 +66,15 @@ public:
 		 * @param texCoords - texture coordinates to use for rendering.
 		 */
 		virtual void render(PosTexShader& s, const std::array<kolme::Vec2f, 4>& texCoords = PosTexShader::quadFanTexCoords)const = 0;
+		
+		/**
+		 * @brief Register widget which renders this texture.
+		 * Contents of the texture can be replaced later, for example, when background rasterization
+		 * of a vector image finishes. Then the registered widgets are invalidated, so that their
+		 * cached renderings get updated. Textures which never change ignore the registration.
+		 * @param w - widget to invalidate when contents of the texture change.
+		 */
+		virtual void addUser(std::weak_ptr<Widget> w)const{}
 	};
 
 	/**
@@ -78,11 +89,17 @@ public:
 	 * @param forDim - dimensions request for raster texture.
 	 *        If any of the dimensions is 0 then it will be adjusted to preserve aspect ratio.
 	 *        If both dimensions are zero, then dimensions which are natural for the particular image will be used.
+	 * For vector images, new dimensions are rasterized in background. Until that is done, the returned texture
+	 * draws the previously rasterized texture of the nearest dimensions, scaled. The widgets registered
+	 * with QuadTexture::addUser() are invalidated when the texture of requested dimensions is ready.
 	 */
 	virtual std::shared_ptr<const QuadTexture> get(Vec2r forDim = 0)const = 0;
 private:
 	static std::shared_ptr<ResImage> load(const stob::Node& chain, const papki::File& fi);
 	
+	//Raster images are decoded and SVG documents are parsed on worker thread, atlas images are loaded on UI thread.
+	static T_Finisher decode(const stob::Node& chain, const papki::File& fi);
+	
 public:
 	/**
 	 * @brief Load image resource from image file.
@@ -47,6 +47,11 @@ public:
 		ASSERT(this->tex)
 		this->tex->render(s, this->texCoords);
 	}
+	
+	void addUser(std::weak_ptr<Widget> w)const override{
+		ASSERT(this->tex)
+		this->tex->addUser(std::move(w));
+	}
 };
 
 }
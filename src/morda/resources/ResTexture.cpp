@@ -19,3 +19,16 @@ std::shared_ptr<ResTexture> ResTexture::load(const stob::Node& chain, const papk
 
 	return utki::makeShared<ResTexture>(loadTexture(fi));
 }
+
+
+
+//static
+Resource::T_Finisher ResTexture::decode(const stob::Node& chain, const papki::File& fi){
+	fi.setPath(chain.side("file").up().value());
+
+	auto image = std::make_shared<Image>(fi);
+	image->flipVertical();
+	return [image](){
+		return utki::makeShared<ResTexture>(Texture2D(*image));
+	};
+}
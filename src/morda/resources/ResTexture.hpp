@@ -49,8 +49,15 @@ public:
 		return this->tex_v;
 	}
 
+	size_t memoryUsage()const noexcept override{
+		return this->tex_v.bytes();
+	}
+
 private:
 	static std::shared_ptr<ResTexture> load(const stob::Node& chain, const papki::File& fi);
+
+	//Image is decoded on worker thread, texture is created on UI thread.
+	static T_Finisher decode(const stob::Node& chain, const papki::File& fi);
 };
 
 
@@ -90,9 +90,7 @@ private:
 			TRACE(<< "ClrPosShader::renderInternal(): passed in array sizes do not match: p.size() = " << p.size() << " c.size() = " << c.size() << std::endl)
 			throw morda::Exc("ClrPosShader::renderInternal(): passed in array sizes do not match");
 		}
-		this->setVertexAttribArray(this->positionAttr, p);
-		this->setVertexAttribArray(this->colorAttr, c);
-		this->renderArrays(mode, p.size());
+		this->renderBatched(mode, utki::Buf<std::uint16_t>(nullptr, 0), this->positionAttr, p, this->colorAttr, c);
 	}
 	
 	template <class V, class C> void renderInternal(const utki::Buf<std::uint16_t> i, const utki::Buf<V> p, const utki::Buf<C> c, Render::Mode_e mode){
@@ -100,9 +98,7 @@ private:
 			TRACE(<< "ClrPosShader::renderInternal(): passed in array sizes do not match: p.size() = " << p.size() << " c.size() = " << c.size() << std::endl)
 			throw morda::Exc("ClrPosShader::renderInternal(): passed in array sizes do not match");
 		}
-		this->setVertexAttribArray(this->positionAttr, p);
-		this->setVertexAttribArray(this->colorAttr, c);
-		this->renderElements(mode, i);
+		this->renderBatched(mode, i, this->positionAttr, p, this->colorAttr, c);
 	}
 };
 
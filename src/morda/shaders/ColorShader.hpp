@@ -20,6 +20,11 @@ namespace morda{
 class ColorShader : virtual public Shader{
 
 	Render::InputID colorUniform;
+	
+	//Current value of the color uniform. Setting the same color again is skipped
+	//to avoid needless flushing of batched geometry.
+	kolme::Vec4f curColor;
+	bool isColorSet = false;
 
 protected:
 	ColorShader() :
@@ -32,6 +37,17 @@ public:
 	ColorShader(const ColorShader&) = delete;
 	ColorShader& operator=(const ColorShader&) = delete;
 	
+	/**
+	 * @brief Get current value of color uniform.
+	 * @return Color value which was last set, or white if it was not set yet.
+	 */
+	kolme::Vec4f color()const noexcept{
+		if(!this->isColorSet){
+			return kolme::Vec4f(1.0f);
+		}
+		return this->curColor;
+	}
+	
 	/**
 	 * @brief Set value of color uniform.
 	 * @param color - color value to set.
@@ -50,7 +66,7 @@ public:
 	 * @param color - color value to set.
 	 */
 	void setColor(kolme::Vec3f color){
-		this->setUniform4f(this->colorUniform, color.x, color.y, color.z, 1.0f);
+		this->setColor(color.x, color.y, color.z, 1.0f);
     }
 
 	/**
@@ -59,7 +75,7 @@ public:
 	 * @param alpha - alpha component of color value to set.
 	 */
 	void setColor(kolme::Vec3f color, float alpha){
-		this->setUniform4f(this->colorUniform, color.x, color.y, color.z, alpha);
+		this->setColor(color.x, color.y, color.z, alpha);
     }
 	
 	/**
@@ -70,7 +86,7 @@ public:
 	 * @param a - alpha component of color value to set.
 	 */
 	void setColor(float r, float g, float b, float a){
-		this->setUniform4f(this->colorUniform, r, g, b, a);
+		this->setColor(kolme::Vec4f(r, g, b, a));
 	}
 
 	/**
@@ -78,7 +94,19 @@ public:
 	 * @param color - color value to set.
 	 */
 	void setColor(const kolme::Vec4f& color){
+		if(this->isColorSet
+				&& this->curColor.x == color.x
+				&& this->curColor.y == color.y
+				&& this->curColor.z == color.z
+				&& this->curColor.w == color.w
+			)
+		{
+			this->bind();
+			return;
+		}
 		this->setUniform4f(this->colorUniform, utki::wrapBuf(&color, 1));
+		this->curColor = color;
+		this->isColorSet = true;
     }
 };
 
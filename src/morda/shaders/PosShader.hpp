@@ -80,13 +80,11 @@ public:
 	
 private:
 	template <class V> void render(const utki::Buf<V> p, Render::Mode_e mode){
-		this->setVertexAttribArray(this->positionAttr, p);
-		this->renderArrays(mode, p.size());
+		this->renderBatched(mode, utki::Buf<std::uint16_t>(nullptr, 0), this->positionAttr, p);
 	}
 	
 	template <class V> void render(const utki::Buf<std::uint16_t> i, const utki::Buf<V> p, Render::Mode_e mode){
-		this->setVertexAttribArray(this->positionAttr, p);
-		this->renderElements(mode, i);
+		this->renderBatched(mode, i, this->positionAttr, p);
 	}
 };
 
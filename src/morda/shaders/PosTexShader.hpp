@@ -92,9 +92,7 @@ private:
 			TRACE(<< "PosTexShader::renderInternal(): passed in array sizes do not match: p.size() = " << p.size() << " t.size() = " << t.size() << std::endl)
 			throw morda::Exc("PosTexShader::renderInternal(): passed in array sizes do not match");
 		}
-		this->setVertexAttribArray(this->positionAttr, p);
-		this->setVertexAttribArray(this->texCoordAttr, t);
-		this->renderArrays(mode, p.size());
+		this->renderBatched(mode, utki::Buf<std::uint16_t>(nullptr, 0), this->positionAttr, p, this->texCoordAttr, t);
 	}
 	
 	template <class V> void renderInternal(const utki::Buf<std::uint16_t> i, const utki::Buf<V> p, const utki::Buf<kolme::Vec2f> t, Render::Mode_e mode){
@@ -102,9 +100,7 @@ private:
 			TRACE(<< "PosTexShader::renderInternal(): passed in array sizes do not match: p.size() = " << p.size() << " t.size() = " << t.size() << std::endl)
 			throw morda::Exc("PosTexShader::renderInternal(): passed in array sizes do not match");
 		}
-		this->setVertexAttribArray(this->positionAttr, p);
-		this->setVertexAttribArray(this->texCoordAttr, t);
-		this->renderElements(mode, i);
+		this->renderBatched(mode, i, this->positionAttr, p, this->texCoordAttr, t);
 	}
 };
 
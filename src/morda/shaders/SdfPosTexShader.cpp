@@ -0,0 +1,78 @@
+#include "SdfPosTexShader.hpp"
+
+
+using namespace morda;
+
+
+
+SdfPosTexShader::SdfPosTexShader() :
+		Shader(
+				R"qwertyuiop(
+						#ifndef GL_ES
+						#	define highp
+						#	define mediump
+						#	define lowp
+						#endif
+
+						attribute highp vec4 pos;
+
+						attribute highp vec2 texCoord0;
+
+						uniform highp mat4 matrix;
+
+						varying highp vec2 tc0;
+
+						void main(void){
+							gl_Position = matrix * pos;
+							tc0 = texCoord0;
+						}
+					)qwertyuiop",
+				R"qwertyuiop(
+						#ifndef GL_ES
+						#	define highp
+						#	define mediump
+						#	define lowp
+						#endif
+		
+						uniform sampler2D texture0;
+		
+						uniform highp vec4 uniformColor;
+						
+						//x - shape edge, y - outline edge, z - smoothing, w - 1 if there is no outline
+						uniform highp vec4 edges;
+		
+						varying highp vec2 tc0;
+		
+						void main(void){
+							highp float d = texture2D(texture0, tc0).r;
+							highp float lum = max(edges.w, smoothstep(edges.x - edges.z, edges.x + edges.z, d));
+							highp float alpha = smoothstep(edges.y - edges.z, edges.y + edges.z, d);
+							gl_FragColor = vec4(uniformColor.rgb * lum, uniformColor.a * alpha);
+						}
+					)qwertyuiop"
+			),
+		edgesUniform(this->getUniform("edges"))
+{
+	this->setEdges(0.5f, 0.5f, 0.05f);
+}
+
+
+
+void SdfPosTexShader::setEdges(float edge, float outlineEdge, float smoothing){
+	kolme::Vec4f e(edge, outlineEdge, smoothing, outlineEdge < edge ? 0.0f : 1.0f);
+	
+	if(this->isEdgesSet
+			&& this->curEdges.x == e.x
+			&& this->curEdges.y == e.y
+			&& this->curEdges.z == e.z
+			&& this->curEdges.w == e.w
+		)
+	{
+		this->bind();
+		return;
+	}
+	
+	this->setUniform4f(this->edgesUniform, e.x, e.y, e.z, e.w);
+	this->curEdges = e;
+	this->isEdgesSet = true;
+}
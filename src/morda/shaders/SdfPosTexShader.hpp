@@ -0,0 +1,40 @@
+#pragma once
+
+#include "PosTexShader.hpp"
+#include "ColorShader.hpp"
+
+
+namespace morda{
+
+/**
+ * @brief Shader for rendering signed distance field textures.
+ * Texture holds the distance to the shape edge in its luminance channel, value of 0.5 corresponds to the edge,
+ * bigger values are inside of the shape. The shape is rendered with uniform color and antialiased edges,
+ * an outline of given width can be added around the shape. Outline is rendered black, as for outlined TexFont glyphs.
+ */
+class SdfPosTexShader :
+		public PosTexShader,
+		public ColorShader
+{
+	Render::InputID edgesUniform;
+	
+	kolme::Vec4f curEdges;
+	bool isEdgesSet = false;
+	
+public:
+	SdfPosTexShader();
+	
+	SdfPosTexShader(const SdfPosTexShader&) = delete;
+	SdfPosTexShader& operator=(const SdfPosTexShader&) = delete;
+	
+	/**
+	 * @brief Set edge parameters.
+	 * All values are in units of the distance field texture values.
+	 * @param edge - distance value of the shape edge.
+	 * @param outlineEdge - distance value of the outer edge of the outline. If it is equal to 'edge' there is no outline.
+	 * @param smoothing - half width of the antialiasing band around the edges.
+	 */
+	void setEdges(float edge, float outlineEdge, float smoothing);
+};
+
+}
@@ -0,0 +1,293 @@
+#include "DiskCache.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+#include <utki/debug.hpp>
+
+#include <papki/FSFile.hpp>
+
+
+using namespace morda;
+
+
+
+namespace{
+const char* indexFileName_c = "index";
+
+//Saving the index writes all the entries, so it is not saved on every store.
+const size_t maxUnsavedChanges_c = 32;
+}
+
+
+
+DiskCache::~DiskCache()noexcept{
+	if(this->indexDirty){
+		try{
+			this->saveIndex();
+		}catch(...){}
+	}
+}
+
+
+
+void DiskCache::setDir(const std::string& dir){
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if(this->indexDirty){
+		this->saveIndex();
+	}
+
+	this->entries.clear();
+	this->lru.clear();
+	this->totalSize = 0;
+	this->indexLoaded = false;
+	this->indexDirty = false;
+	this->numUnsavedChanges = 0;
+
+	this->dir_v = dir;
+	if(this->dir_v.size() != 0 && this->dir_v.back() != '/'){
+		this->dir_v.append(1, '/');
+	}
+}
+
+
+
+void DiskCache::setMaxSize(size_t maxSize){
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->maxSize_v = maxSize;
+
+	if(this->isEnabled()){
+		this->loadIndex();
+		this->evict();
+		if(this->indexDirty){
+			this->saveIndex();
+		}
+	}
+}
+
+
+
+size_t DiskCache::size()const{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->loadIndex();
+	return this->totalSize;
+}
+
+
+
+std::string DiskCache::entryPath(const std::string& key)const{
+	return this->dir_v + key;
+}
+
+
+
+void DiskCache::loadIndex()const{
+	if(this->indexLoaded || !this->isEnabled()){
+		return;
+	}
+	this->indexLoaded = true;
+
+	std::vector<std::uint8_t> data;
+	try{
+		papki::FSFile fi(this->entryPath(indexFileName_c));
+		if(!fi.exists()){
+			return;
+		}
+		data = fi.loadWholeFileIntoMemory();
+	}catch(std::exception&){
+		return;
+	}
+
+	//each line of index file is "<key> <size>", least recently used entries go first
+	std::istringstream ss(std::string(data.begin(), data.end()));
+	std::string key;
+	size_t size;
+	while(ss >> key >> size){
+		this->touch(key, size);
+	}
+	this->indexDirty = false;
+	this->numUnsavedChanges = 0;
+}
+
+
+
+void DiskCache::saveIndex()const{
+	if(!this->isEnabled()){
+		return;
+	}
+
+	std::ostringstream ss;
+	for(auto& key : this->lru){
+		auto i = this->entries.find(key);
+		ASSERT(i != this->entries.end())
+		ss << key << ' ' << i->second.size << '\n';
+	}
+	std::string str = ss.str();
+
+	std::string path = this->entryPath(indexFileName_c);
+	std::string tmpPath = path + ".tmp";
+
+	if(writeFile(tmpPath, utki::wrapBuf(reinterpret_cast<const std::uint8_t*>(str.data()), str.size()))
+			&& std::rename(tmpPath.c_str(), path.c_str()) == 0)
+	{
+		this->indexDirty = false;
+		this->numUnsavedChanges = 0;
+	}else{
+		std::remove(tmpPath.c_str());
+	}
+}
+
+
+
+void DiskCache::touch(const std::string& key, size_t size)const{
+	auto i = this->entries.find(key);
+	if(i != this->entries.end()){
+		this->totalSize -= i->second.size;
+		this->lru.erase(i->second.lruIter);
+	}else{
+		i = this->entries.insert(std::make_pair(key, Entry())).first;
+	}
+
+	i->second.size = size;
+	i->second.lruIter = this->lru.insert(this->lru.end(), key);
+	this->totalSize += size;
+
+	this->indexDirty = true;
+	++this->numUnsavedChanges;
+}
+
+
+
+bool DiskCache::evict()const{
+	if(this->maxSize_v == 0){
+		return false;
+	}
+
+	bool ret = false;
+	while(this->totalSize > this->maxSize_v && this->lru.size() != 0){
+		auto i = this->entries.find(this->lru.front());
+		ASSERT(i != this->entries.end())
+
+		std::remove(this->entryPath(i->first).c_str());
+
+		this->totalSize -= i->second.size;
+		this->entries.erase(i);
+		this->lru.pop_front();
+
+		this->indexDirty = true;
+		++this->numUnsavedChanges;
+		ret = true;
+	}
+	return ret;
+}
+
+
+
+bool DiskCache::writeFile(const std::string& path, const utki::Buf<std::uint8_t> data){
+	try{
+		papki::FSFile fi(path);
+		papki::File::Guard fileGuard(fi, papki::File::E_Mode::CREATE);
+		return fi.write(data) == data.size();
+	}catch(std::exception&){
+		return false;
+	}
+}
+
+
+
+std::vector<std::uint8_t> DiskCache::load(const std::string& key)const{
+	if(!this->isEnabled()){
+		return std::vector<std::uint8_t>();
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->loadIndex();
+
+	std::vector<std::uint8_t> ret;
+	try{
+		papki::FSFile fi(this->entryPath(key));
+		if(!fi.exists()){
+			return std::vector<std::uint8_t>();
+		}
+		ret = fi.loadWholeFileIntoMemory();
+	}catch(std::exception&){
+		return std::vector<std::uint8_t>();
+	}
+
+	//NOTE: entries which are missing from index, e.g. because index was not saved, are added to it
+	this->touch(key, ret.size());
+	
+	//added entries can make the cache exceed its maximum size, index must not refer to deleted entries
+	if(this->evict()){
+		this->saveIndex();
+	}
+
+	return ret;
+}
+
+
+
+void DiskCache::store(const std::string& key, const utki::Buf<std::uint8_t> data){
+	if(!this->isEnabled()){
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->loadIndex();
+
+	std::string path = this->entryPath(key);
+	std::string tmpPath = path + ".tmp";
+
+	if(!writeFile(tmpPath, data)){
+		std::remove(tmpPath.c_str());
+		return;
+	}
+
+	if(std::rename(tmpPath.c_str(), path.c_str()) != 0){
+		std::remove(tmpPath.c_str());
+		return;
+	}
+
+	this->touch(key, data.size());
+
+	//index must not refer to deleted entries, otherwise save it in batches
+	if(this->evict() || this->numUnsavedChanges >= maxUnsavedChanges_c){
+		this->saveIndex();
+	}
+}
+
+
+
+void DiskCache::flush(){
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if(this->indexDirty){
+		this->saveIndex();
+	}
+}
+
+
+
+std::uint64_t DiskCache::hash(const utki::Buf<std::uint8_t> data, std::uint64_t hash)noexcept{
+	for(auto b : data){
+		hash ^= b;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+
+
+std::string DiskCache::hashToString(std::uint64_t hash){
+	const char* digits = "0123456789abcdef";
+	std::string ret(16, '0');
+	for(auto i = ret.rbegin(); i != ret.rend(); ++i){
+		*i = digits[hash & 0xf];
+		hash >>= 4;
+	}
+	return ret;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <utki/Buf.hpp>
+
+
+namespace morda{
+
+
+/**
+ * @brief Cache of data blobs in a file system directory.
+ * Each cache entry is stored in a separate file named by the entry key.
+ * Cache is disabled until cache directory is set.
+ * Errors of reading and writing the cache files are not reported, failed
+ * reading is treated as missing entry and failed writing just does not store the entry.
+ * Total size of the cache can be limited, in which case least recently used entries are deleted
+ * when the limit is exceeded. For that, the cache keeps the list of its entries in the "index" file
+ * in the cache directory, so each cache object should use its own directory.
+ * Entries can be loaded and stored from several threads concurrently, but cache directory and
+ * maximum size should be set before that.
+ */
+class DiskCache{
+	std::string dir_v;
+
+	size_t maxSize_v;
+
+	mutable std::mutex mutex;
+
+	struct Entry{
+		size_t size;
+		std::list<std::string>::iterator lruIter;
+	};
+
+	//index of the cache entries, loaded from index file on first use
+	mutable std::unordered_map<std::string, Entry> entries;
+
+	//keys of the cache entries, least recently used first
+	mutable std::list<std::string> lru;
+
+	mutable size_t totalSize = 0;
+
+	mutable bool indexLoaded = false;
+	mutable bool indexDirty = false;
+
+	//number of index changes since the index was saved
+	mutable size_t numUnsavedChanges = 0;
+
+	std::string entryPath(const std::string& key)const;
+
+	void loadIndex()const;
+	void saveIndex()const;
+
+	void touch(const std::string& key, size_t size)const;
+	//returns true if any entries were deleted
+	bool evict()const;
+
+	static bool writeFile(const std::string& path, const utki::Buf<std::uint8_t> data);
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param maxSize - maximum total size of the cache entries in bytes. Zero means unlimited.
+	 */
+	DiskCache(size_t maxSize = 0) :
+			maxSize_v(maxSize)
+	{}
+
+	~DiskCache()noexcept;
+
+	DiskCache(const DiskCache&) = delete;
+	DiskCache& operator=(const DiskCache&) = delete;
+
+	/**
+	 * @brief Set cache directory.
+	 * The directory should exist.
+	 * @param dir - path to the cache directory. Empty string disables the cache.
+	 */
+	void setDir(const std::string& dir);
+
+	/**
+	 * @brief Get cache directory.
+	 * @return Path to the cache directory, with trailing slash.
+	 * @return Empty string if cache is disabled.
+	 */
+	const std::string& dir()const noexcept{
+		return this->dir_v;
+	}
+
+	/**
+	 * @brief Set maximum size of the cache.
+	 * Least recently used entries are deleted when total size of the entries exceeds the maximum size.
+	 * @param maxSize - maximum total size of the cache entries in bytes. Zero means unlimited.
+	 */
+	void setMaxSize(size_t maxSize);
+
+	/**
+	 * @brief Get maximum size of the cache.
+	 * @return Maximum total size of the cache entries in bytes. Zero means unlimited.
+	 */
+	size_t maxSize()const noexcept{
+		return this->maxSize_v;
+	}
+
+	/**
+	 * @brief Get total size of the cache entries.
+	 * @return Total size of the cache entries in bytes.
+	 */
+	size_t size()const;
+
+	/**
+	 * @brief Check if cache is enabled.
+	 * @return true if cache directory is set.
+	 * @return false otherwise.
+	 */
+	bool isEnabled()const noexcept{
+		return this->dir_v.size() != 0;
+	}
+
+	/**
+	 * @brief Load cache entry.
+	 * Loaded entry becomes the most recently used one.
+	 * @param key - key of the entry, it is used as file name, so it should only contain characters allowed in file names.
+	 *        Key "index" is reserved.
+	 * @return Entry data.
+	 * @return Empty vector if there is no such entry or cache is disabled.
+	 */
+	std::vector<std::uint8_t> load(const std::string& key)const;
+
+	/**
+	 * @brief Store cache entry.
+	 * Entry file is written under temporary name and then renamed, so that partially written entries are never loaded.
+	 * Does nothing if cache is disabled.
+	 * If the cache size limit is exceeded, then least recently used entries are deleted.
+	 * Index file is saved when entries are deleted, otherwise it is saved after every several stored entries.
+	 * @param key - key of the entry.
+	 * @param data - entry data.
+	 */
+	void store(const std::string& key, const utki::Buf<std::uint8_t> data);
+
+	/**
+	 * @brief Save index of the cache entries.
+	 * Index is also saved when the cache object is destroyed or the cache directory is changed.
+	 * Entries missing from the index are added to it when they are loaded, so unsaved index only
+	 * affects the order in which the entries are deleted.
+	 */
+	void flush();
+
+	/**
+	 * @brief Calculate hash of data.
+	 * Hash can be used for making entry keys from the data the entry is derived from.
+	 * Uses 64 bit FNV-1a hash.
+	 * @param data - data to calculate hash of.
+	 * @param hash - hash to continue from, for calculating hash of several pieces of data.
+	 * @return Hash of the data.
+	 */
+	static std::uint64_t hash(const utki::Buf<std::uint8_t> data, std::uint64_t hash = 0xcbf29ce484222325ull)noexcept;
+
+	/**
+	 * @brief Convert hash to string.
+	 * @param hash - hash value.
+	 * @return Hexadecimal representation of the hash.
+	 */
+	static std::string hashToString(std::uint64_t hash);
+};
+
+}
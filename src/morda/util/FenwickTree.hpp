@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+
+#include <utki/debug.hpp>
+
+
+namespace morda{
+
+
+/**
+ * @brief Binary indexed tree.
+ * Keeps a sequence of non-negative values and allows changing a value and getting
+ * a sum of the first values, as well as finding a value by its prefix sum, in O(log n).
+ * @param T - value type.
+ */
+template <class T> class FenwickTree{
+	//1-based tree, element 0 is unused
+	std::vector<T> tree = std::vector<T>(1, T(0));
+
+	static size_t lowBit(size_t i)noexcept{
+		return i & (~i + 1);
+	}
+
+public:
+	/**
+	 * @brief Get number of values.
+	 * @return Number of values in the tree.
+	 */
+	size_t size()const noexcept{
+		return this->tree.size() - 1;
+	}
+
+	/**
+	 * @brief Remove all values.
+	 */
+	void clear(){
+		this->tree.resize(1);
+	}
+
+	/**
+	 * @brief Append value.
+	 * @param v - value to append.
+	 */
+	void push_back(T v){
+		size_t i = this->tree.size();
+
+		//node i holds the sum of values in range (i - lowBit(i), i]
+		T s = v;
+		for(size_t j = i - 1, end = i - lowBit(i); j != end; j -= lowBit(j)){
+			s += this->tree[j];
+		}
+		this->tree.push_back(s);
+	}
+
+	/**
+	 * @brief Add to value.
+	 * @param index - index of the value to change.
+	 * @param delta - amount to add to the value, can be negative for signed types.
+	 */
+	void add(size_t index, T delta)noexcept{
+		ASSERT(index < this->size())
+		for(size_t i = index + 1; i < this->tree.size(); i += lowBit(i)){
+			this->tree[i] += delta;
+		}
+	}
+
+	/**
+	 * @brief Get sum of first values.
+	 * @param n - number of values to sum.
+	 * @return Sum of first n values.
+	 */
+	T prefixSum(size_t n)const noexcept{
+		ASSERT(n <= this->size())
+		T ret = T(0);
+		for(; n != 0; n -= lowBit(n)){
+			ret += this->tree[n];
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief Get sum of all values.
+	 * @return Sum of all values.
+	 */
+	T total()const noexcept{
+		return this->prefixSum(this->size());
+	}
+
+	/**
+	 * @brief Find value by prefix sum.
+	 * @param sum - prefix sum to find the value for.
+	 * @return Index of the first value for which sum of the values up to and including it is greater than the given sum.
+	 * @return Number of values if sum of all values is not greater than the given sum.
+	 */
+	size_t upperBound(T sum)const noexcept{
+		size_t pos = 0;
+
+		size_t step = 1;
+		while(step * 2 < this->tree.size()){
+			step *= 2;
+		}
+
+		for(; step != 0; step /= 2){
+			if(pos + step < this->tree.size() && this->tree[pos + step] <= sum){
+				pos += step;
+				sum -= this->tree[pos];
+			}
+		}
+		return pos;
+	}
+};
+
+}
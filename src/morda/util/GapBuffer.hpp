@@ -0,0 +1,142 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <utki/debug.hpp>
+
+
+namespace morda{
+
+
+/**
+ * @brief Editable sequence of elements.
+ * Gap buffer keeps elements in a single array with a gap of unused elements at the place
+ * of the last edit. Insertions and deletions at the gap do not move any elements, so
+ * consecutive edits at nearby positions, like typing text, cost amortized O(1) per element.
+ * Moving the gap to another position costs moving the elements between the old and the new positions.
+ * @param T - element type, should be default constructible and copyable.
+ */
+template <class T> class GapBuffer{
+	std::vector<T> buf;
+
+	size_t gapStart = 0;
+	size_t gapEnd = 0;
+
+	size_t gapSize()const noexcept{
+		return this->gapEnd - this->gapStart;
+	}
+
+	void moveGap(size_t pos){
+		ASSERT(pos <= this->size())
+		if(pos < this->gapStart){
+			std::move_backward(this->buf.begin() + pos, this->buf.begin() + this->gapStart, this->buf.begin() + this->gapEnd);
+		}else if(pos > this->gapStart){
+			std::move(this->buf.begin() + this->gapEnd, this->buf.begin() + this->gapEnd + (pos - this->gapStart), this->buf.begin() + this->gapStart);
+		}
+		this->gapEnd = pos + this->gapSize();
+		this->gapStart = pos;
+	}
+
+	void growGap(size_t minSize){
+		if(this->gapSize() >= minSize){
+			return;
+		}
+
+		size_t tail = this->buf.size() - this->gapEnd;
+
+		size_t newSize = std::max(this->size() + minSize, this->buf.size() * 2);
+		if(newSize < 16){
+			newSize = 16;
+		}
+
+		this->buf.resize(newSize);
+
+		//move elements after the gap to the end of the enlarged array
+		std::move_backward(this->buf.begin() + this->gapEnd, this->buf.begin() + this->gapEnd + tail, this->buf.end());
+		this->gapEnd = newSize - tail;
+	}
+
+public:
+	GapBuffer() = default;
+
+	/**
+	 * @brief Get number of elements.
+	 * @return Number of elements in the buffer.
+	 */
+	size_t size()const noexcept{
+		return this->buf.size() - this->gapSize();
+	}
+
+	/**
+	 * @brief Access element.
+	 * @param i - index of the element.
+	 * @return Reference to the element.
+	 */
+	const T& operator[](size_t i)const noexcept{
+		ASSERT(i < this->size())
+		return i < this->gapStart ? this->buf[i] : this->buf[i + this->gapSize()];
+	}
+
+	/**
+	 * @brief Insert elements.
+	 * @param pos - index to insert the elements at.
+	 * @param p - pointer to the elements to insert.
+	 * @param n - number of elements to insert.
+	 */
+	void insert(size_t pos, const T* p, size_t n){
+		ASSERT(pos <= this->size())
+		if(n == 0){
+			return;
+		}
+		this->moveGap(pos);
+		this->growGap(n);
+		std::copy(p, p + n, this->buf.begin() + this->gapStart);
+		this->gapStart += n;
+	}
+
+	/**
+	 * @brief Remove elements.
+	 * @param pos - index of the first element to remove.
+	 * @param n - number of elements to remove.
+	 */
+	void erase(size_t pos, size_t n){
+		ASSERT(pos + n <= this->size())
+		this->moveGap(pos);
+		this->gapEnd += n;
+	}
+
+	/**
+	 * @brief Remove all elements.
+	 * Memory of the buffer is not freed.
+	 */
+	void clear()noexcept{
+		this->gapStart = 0;
+		this->gapEnd = this->buf.size();
+	}
+
+	/**
+	 * @brief Replace contents of the buffer.
+	 * @param begin - iterator to the first element of the new contents.
+	 * @param end - iterator to the element after the last element of the new contents.
+	 */
+	template <class I> void assign(I begin, I end){
+		this->buf.assign(begin, end);
+		this->gapStart = this->buf.size();
+		this->gapEnd = this->gapStart;
+	}
+
+	/**
+	 * @brief Copy contents to a string.
+	 * @param out - string to copy the contents to. Previous contents of the string are discarded.
+	 */
+	void copyTo(std::basic_string<T>& out)const{
+		out.clear();
+		out.reserve(this->size());
+		out.append(this->buf.data(), this->gapStart);
+		out.append(this->buf.data() + this->gapEnd, this->buf.size() - this->gapEnd);
+	}
+};
+
+}
@@ -0,0 +1,197 @@
+#include "SkylinePacker.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <utki/debug.hpp>
+
+#include "../Exc.hpp"
+
+
+using namespace morda;
+
+
+
+SkylinePacker::SkylinePacker(kolme::Vec2ui dim) :
+		dim_v(dim)
+{
+	this->clear();
+}
+
+
+
+void SkylinePacker::clear(){
+	this->skyline.clear();
+	this->skyline.push_back(Segment{0, 0, this->dim_v.x});
+	this->usedArea = 0;
+}
+
+
+
+int SkylinePacker::fit(size_t segment, kolme::Vec2ui dim)const noexcept{
+	unsigned x = this->skyline[segment].x;
+	if(x + dim.x > this->dim_v.x){
+		return -1;
+	}
+
+	//the rectangle lays on the highest of the segments it spans
+	unsigned y = 0;
+	unsigned widthLeft = dim.x;
+	for(size_t i = segment; widthLeft != 0; ++i){
+		ASSERT(i < this->skyline.size())
+		y = std::max(y, this->skyline[i].y);
+		if(y + dim.y > this->dim_v.y){
+			return -1;
+		}
+		widthLeft -= std::min(widthLeft, this->skyline[i].width);
+	}
+	return int(y);
+}
+
+
+
+bool SkylinePacker::insert(kolme::Vec2ui dim, kolme::Vec2ui& outPos){
+	if(dim.x == 0 || dim.y == 0){
+		outPos = kolme::Vec2ui(0);
+		return true;
+	}
+
+	size_t bestIndex = this->skyline.size();
+	unsigned bestTop = unsigned(-1);
+	unsigned bestWidth = unsigned(-1);
+	unsigned bestY = 0;
+
+	for(size_t i = 0; i != this->skyline.size(); ++i){
+		int y = this->fit(i, dim);
+		if(y < 0){
+			continue;
+		}
+		unsigned top = unsigned(y) + dim.y;
+		if(top < bestTop || (top == bestTop && this->skyline[i].width < bestWidth)){
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = this->skyline[i].width;
+			bestY = unsigned(y);
+		}
+	}
+
+	if(bestIndex == this->skyline.size()){
+		return false;
+	}
+
+	outPos = kolme::Vec2ui(this->skyline[bestIndex].x, bestY);
+	this->addSegment(bestIndex, outPos, dim);
+	this->usedArea += size_t(dim.x) * size_t(dim.y);
+	return true;
+}
+
+
+
+void SkylinePacker::addSegment(size_t index, kolme::Vec2ui pos, kolme::Vec2ui dim){
+	this->skyline.insert(this->skyline.begin() + index, Segment{pos.x, pos.y + dim.y, dim.x});
+
+	//shrink or remove the segments covered by the new one
+	unsigned right = pos.x + dim.x;
+	for(size_t i = index + 1; i < this->skyline.size();){
+		Segment& s = this->skyline[i];
+		if(s.x >= right){
+			break;
+		}
+		unsigned segRight = s.x + s.width;
+		if(segRight <= right){
+			this->skyline.erase(this->skyline.begin() + i);
+			continue;
+		}
+		s.width = segRight - right;
+		s.x = right;
+		break;
+	}
+
+	//merge neighbouring segments of the same height
+	for(size_t i = 0; i + 1 < this->skyline.size();){
+		if(this->skyline[i].y == this->skyline[i + 1].y){
+			this->skyline[i].width += this->skyline[i + 1].width;
+			this->skyline.erase(this->skyline.begin() + i + 1);
+		}else{
+			++i;
+		}
+	}
+}
+
+
+
+float SkylinePacker::occupancy()const noexcept{
+	size_t area = size_t(this->dim_v.x) * size_t(this->dim_v.y);
+	if(area == 0){
+		return 0;
+	}
+	return float(this->usedArea) / float(area);
+}
+
+
+
+kolme::Vec2ui SkylinePacker::pack(const std::vector<kolme::Vec2ui>& dims, std::vector<kolme::Vec2ui>& outPositions, unsigned maxDim, unsigned gap){
+	outPositions.resize(dims.size());
+
+	std::vector<size_t> order(dims.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&dims](size_t a, size_t b){
+		if(dims[a].y != dims[b].y){
+			return dims[a].y > dims[b].y;
+		}
+		return dims[a].x > dims[b].x;
+	});
+
+	//each rectangle takes the gap to its right and top, the gap at left and bottom edges of the area is reserved
+	size_t area = 0;
+	kolme::Vec2ui maxRect(0);
+	for(auto& d : dims){
+		area += size_t(d.x + gap) * size_t(d.y + gap);
+		maxRect.x = std::max(maxRect.x, d.x + 2 * gap);
+		maxRect.y = std::max(maxRect.y, d.y + 2 * gap);
+	}
+
+	//start with the smallest power of 2 area which can hold all the rectangles
+	kolme::Vec2ui dim(1);
+	while(dim.x < maxRect.x){
+		dim.x <<= 1;
+	}
+	while(dim.y < maxRect.y){
+		dim.y <<= 1;
+	}
+	while(size_t(dim.x) * size_t(dim.y) < area){
+		if(dim.x <= dim.y){
+			dim.x <<= 1;
+		}else{
+			dim.y <<= 1;
+		}
+	}
+
+	for(;;){
+		if(dim.x > maxDim || dim.y > maxDim){
+			throw morda::Exc("SkylinePacker::pack(): rectangles do not fit the area of maximum dimensions");
+		}
+
+		SkylinePacker packer(dim - kolme::Vec2ui(gap));
+
+		bool fits = true;
+		for(auto i : order){
+			if(!packer.insert(dims[i] + kolme::Vec2ui(gap), outPositions[i])){
+				fits = false;
+				break;
+			}
+			outPositions[i] += kolme::Vec2ui(gap);
+		}
+
+		if(fits){
+			return dim;
+		}
+
+		//grow the smaller dimension, keep the area close to square
+		if(dim.x <= dim.y && dim.x < maxDim){
+			dim.x <<= 1;
+		}else{
+			dim.y <<= 1;
+		}
+	}
+}
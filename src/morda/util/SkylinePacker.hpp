@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include <kolme/Vector2.hpp>
+
+
+namespace morda{
+
+
+/**
+ * @brief Rectangle packer for building texture atlases.
+ * Packer uses the skyline bottom-left algorithm. It keeps the upper contour of already placed
+ * rectangles as a list of horizontal segments and puts each new rectangle where its top edge
+ * will be the lowest. Unlike the row-by-row packing, this way the rectangles fill the gaps
+ * above shorter neighbours.
+ */
+class SkylinePacker{
+	struct Segment{
+		unsigned x;
+		unsigned y;
+		unsigned width;
+	};
+
+	kolme::Vec2ui dim_v;
+
+	std::vector<Segment> skyline;
+
+	size_t usedArea = 0;
+
+	//returns y position of the rectangle if it is placed at the given segment, or -1 if it does not fit
+	int fit(size_t segment, kolme::Vec2ui dim)const noexcept;
+
+	void addSegment(size_t index, kolme::Vec2ui pos, kolme::Vec2ui dim);
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param dim - dimensions of the area to pack rectangles into.
+	 */
+	SkylinePacker(kolme::Vec2ui dim);
+
+	/**
+	 * @brief Place rectangle.
+	 * @param dim - dimensions of the rectangle.
+	 * @param outPos - position of the placed rectangle.
+	 * @return true if the rectangle was placed.
+	 * @return false if there is no room for the rectangle.
+	 */
+	bool insert(kolme::Vec2ui dim, kolme::Vec2ui& outPos);
+
+	/**
+	 * @brief Remove all rectangles.
+	 */
+	void clear();
+
+	/**
+	 * @brief Get dimensions of the packing area.
+	 * @return Dimensions of the packing area.
+	 */
+	const kolme::Vec2ui& dim()const noexcept{
+		return this->dim_v;
+	}
+
+	/**
+	 * @brief Get fraction of the area occupied by the placed rectangles.
+	 * @return Occupancy, from 0 to 1.
+	 */
+	float occupancy()const noexcept;
+
+	/**
+	 * @brief Pack set of rectangles into as small area as possible.
+	 * Area dimensions are powers of 2. Starting from the smallest area which can hold all the rectangles,
+	 * the area is grown until all rectangles fit. Rectangles are placed in the order of decreasing height
+	 * which gives better packing.
+	 * @param dims - dimensions of the rectangles.
+	 * @param outPositions - positions of the packed rectangles, in the same order as the dimensions.
+	 * @param maxDim - maximum dimension of the area.
+	 * @param gap - number of empty pixels to leave between rectangles and between rectangles and area edges.
+	 * @return Dimensions of the area.
+	 * @throw morda::Exc if rectangles do not fit the area of maximum dimensions.
+	 */
+	static kolme::Vec2ui pack(const std::vector<kolme::Vec2ui>& dims, std::vector<kolme::Vec2ui>& outPositions, unsigned maxDim, unsigned gap = 0);
+};
+
+}
@@ -0,0 +1,83 @@
+#include "WorkerPool.hpp"
+
+#include <system_error>
+
+#include <utki/debug.hpp>
+
+
+using namespace morda;
+
+
+
+WorkerPool::WorkerPool(unsigned maxThreads) :
+		maxThreads_v(maxThreads != 0 ? maxThreads : std::thread::hardware_concurrency())
+{
+	if(this->maxThreads_v == 0){
+		this->maxThreads_v = 1;
+	}
+}
+
+
+
+WorkerPool::~WorkerPool()noexcept{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->quit = true;
+		this->queue.clear();
+	}
+	this->cv.notify_all();
+
+	for(auto& t : this->threads){
+		t.join();
+	}
+}
+
+
+
+void WorkerPool::post_ts(std::function<void()>&& task){
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->queue.push_back(std::move(task));
+
+		if(this->numIdle < this->queue.size() && this->threads.size() < this->maxThreads_v){
+			try{
+				this->threads.emplace_back([this](){this->run();});
+			}catch(std::system_error&){
+				//could not start new thread, the task will be executed by one of the existing threads
+				if(this->threads.size() == 0){
+					throw;
+				}
+			}
+		}
+	}
+	this->cv.notify_one();
+}
+
+
+
+void WorkerPool::run(){
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	for(;;){
+		++this->numIdle;
+		this->cv.wait(lock, [this](){return this->quit || this->queue.size() != 0;});
+		--this->numIdle;
+
+		if(this->quit){
+			return;
+		}
+
+		auto task = std::move(this->queue.front());
+		this->queue.pop_front();
+
+		lock.unlock();
+		try{
+			task();
+		}catch(std::exception& e){
+			TRACE(<< "WorkerPool: task has thrown an exception: " << e.what() << std::endl)
+		}catch(...){
+			TRACE(<< "WorkerPool: task has thrown an exception" << std::endl)
+		}
+		lock.lock();
+	}
+}
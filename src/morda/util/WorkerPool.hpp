@@ -0,0 +1,60 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+
+namespace morda{
+
+
+/**
+ * @brief Pool of worker threads.
+ * Executes posted tasks on worker threads. Threads are started when tasks are posted
+ * and there is no idle thread, up to the maximum number of threads.
+ * Tasks which are not started by the time the pool is destroyed are discarded.
+ */
+class WorkerPool{
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	std::deque<std::function<void()>> queue;
+
+	std::vector<std::thread> threads;
+
+	unsigned numIdle = 0;
+
+	bool quit = false;
+
+	unsigned maxThreads_v;
+
+	void run();
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param maxThreads - maximum number of worker threads. Zero means the number of hardware threads.
+	 */
+	WorkerPool(unsigned maxThreads = 0);
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	/**
+	 * @brief Destructor.
+	 * Waits for the tasks being executed to finish.
+	 */
+	~WorkerPool()noexcept;
+
+	/**
+	 * @brief Post task for execution on a worker thread.
+	 * This function is thread-safe.
+	 * @param task - task to execute.
+	 */
+	void post_ts(std::function<void()>&& task);
+};
+
+}
@@ -131,6 +131,19 @@ Texture2D loadTexture(const papki::File& fi);
  */
 real findDotsPerPt(kolme::Vec2ui resolution, kolme::Vec2ui screenSizeMm);
 
+/**
+ * @brief Check if two rectangles overlap.
+ * Rectangles which only touch each other by their sides are not considered overlapping.
+ * @param a - first rectangle.
+ * @param b - second rectangle.
+ * @return true if rectangles have common area.
+ * @return false otherwise.
+ */
+template <class T> bool overlap(const kolme::Rectangle<T>& a, const kolme::Rectangle<T>& b)noexcept{
+	return a.p.x < b.p.x + b.d.x && b.p.x < a.p.x + a.d.x
+			&& a.p.y < b.p.y + b.d.y && b.p.y < a.p.y + a.d.y;
+}
+
 /**
  * @brief Enable simple alpha blending to rendering context.
  * Enables simple alpha blending on the rendering context.
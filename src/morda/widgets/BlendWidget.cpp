@@ -82,6 +82,7 @@ void BlendWidget::setBlendEnabled(bool enable){
 		return;
 	}
 	this->isBlendEnabled_v = enable;
+	this->invalidate();
 	this->onBlendChanged();
 }
 
@@ -90,5 +91,6 @@ void BlendWidget::setBlend(const Blend& blend){
 		return;
 	}
 	this->blend_v = blend;
+	this->invalidate();
 	this->onBlendChanged();
 }
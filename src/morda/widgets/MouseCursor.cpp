@@ -17,20 +17,38 @@ MouseCursor::MouseCursor(const stob::Node* chain) :
 }
 
 void MouseCursor::setCursor(std::shared_ptr<const ResCursor> cursor) {
+	this->invalidateCursor();
 	this->cursor = std::move(cursor);
 	this->quadTex.reset();
 	if(this->cursor){
 		this->quadTex = this->cursor->image().get();
 	}
+	this->invalidateCursor();
+}
+
+void MouseCursor::invalidateCursor(){
+	if(!this->quadTex){
+		return;
+	}
+	this->clearCache(Rectr(this->cursorPos - this->cursor->hotspot(), this->quadTex->dim()));
 }
 
 bool MouseCursor::onMouseMove(const morda::Vec2r& pos, unsigned pointerID) {
 	if(pointerID == 0){
+		this->invalidateCursor();
 		this->cursorPos = pos;
+		this->invalidateCursor();
 	}
 	return false;
 }
 
+void MouseCursor::onHoverChanged(unsigned pointerID){
+	//cursor is only shown while hovered
+	if(pointerID == 0){
+		this->invalidateCursor();
+	}
+}
+
 void MouseCursor::render(const morda::Matr4r& matrix) const {
 	if(!this->cursor){
 		return;
@@ -20,6 +20,9 @@ class MouseCursor : virtual public Widget{
 	std::shared_ptr<const ResImage::QuadTexture> quadTex;
 	
 	Vec2r cursorPos;
+	
+	//damages area of the cursor image at current cursor position
+	void invalidateCursor();
 public:
 	MouseCursor(const stob::Node* chain = nullptr);
 	
@@ -29,6 +32,8 @@ public:
 	void setCursor(std::shared_ptr<const ResCursor> cursor);
 	
 	bool onMouseMove(const morda::Vec2r& pos, unsigned pointerID) override;
+	
+	void onHoverChanged(unsigned pointerID) override;
 
 	void render(const morda::Matr4r& matrix) const override;
 };
@@ -2,6 +2,8 @@
 
 #include "../Morda.hpp"
 
+#include <algorithm>
+
 
 
 #if M_OS == M_OS_WINDOWS
@@ -66,12 +68,22 @@ void TextInput::render(const morda::Matr4r& matrix) const{
 			}
 		}();
 		
-		ASSERT(this->firstVisibleCharIndex <= this->text().size())
-		this->font().renderString(
-				s,
-				matr,
-				std::u32string(this->text(), this->firstVisibleCharIndex, this->text().size() - this->firstVisibleCharIndex)
+		auto& a = this->advances();
+		
+		ASSERT(this->firstVisibleCharIndex < a.size())
+		matr.translate(-a[this->firstVisibleCharIndex], 0);
+		
+		//render only the characters which start within the widget, the rest of the retained glyph run is clipped anyway
+		auto end = std::upper_bound(
+				a.begin() + this->firstVisibleCharIndex,
+				a.end(),
+				a[this->firstVisibleCharIndex] - this->xOffset + this->textBoundingBox().p.x + this->rect().d.x
 			);
+		
+		//last element of advances is the end of the text, not a start of a character
+		size_t endIndex = std::min(size_t(std::distance(a.begin(), end)), this->textBuffer().size());
+		
+		this->font().renderString(s, matr, this->glyphRun(), this->firstVisibleCharIndex, endIndex);
 	}
 	
 	if(this->isFocused() && this->cursorBlinkVisible){
@@ -133,7 +145,7 @@ Vec2r TextInput::measure(const morda::Vec2r& quotum)const noexcept{
 void TextInput::setCursorIndex(size_t index, bool selection){
 	this->cursorIndex = index;
 	
-	utki::clampTop(this->cursorIndex, this->text().size());
+	utki::clampTop(this->cursorIndex, this->textBuffer().size());
 	
 	if(!selection){
 		this->selectionStartIndex = this->cursorIndex;
@@ -157,89 +169,74 @@ void TextInput::setCursorIndex(size_t index, bool selection){
 		return;
 	}
 	
-	ASSERT(this->firstVisibleCharIndex <= this->text().size())
+	auto& a = this->advances();
+	
+	ASSERT(this->firstVisibleCharIndex < a.size())
 	ASSERT(this->cursorIndex > this->firstVisibleCharIndex)
-	this->cursorPos = this->font().stringAdvance(
-			std::u32string(this->text(), this->firstVisibleCharIndex, this->cursorIndex - this->firstVisibleCharIndex)
-		) + this->xOffset;
+	ASSERT(this->cursorIndex < a.size())
+	this->cursorPos = a[this->cursorIndex] - a[this->firstVisibleCharIndex] + this->xOffset;
 	
 	ASSERT(this->cursorPos >= 0)
 	
 	if(this->cursorPos > this->rect().d.x - cursorWidth_c * morda::inst().units.dotsPerPt()){
 		this->cursorPos = this->rect().d.x - cursorWidth_c * morda::inst().units.dotsPerPt();
 		
-		this->xOffset = this->cursorPos;//start from rightmost cursor position
-		this->firstVisibleCharIndex = this->cursorIndex;
+		//find the rightmost first visible character which makes the cursor fit into the widget
+		auto i = std::upper_bound(a.begin(), a.begin() + this->cursorIndex + 1, a[this->cursorIndex] - this->cursorPos);
+		ASSERT(i != a.begin())
+		this->firstVisibleCharIndex = size_t(std::distance(a.begin(), i) - 1);
 		
-		//calculate advance backwards
-		for(auto i = this->text().rbegin() + (this->text().size() - this->cursorIndex);
-				this->xOffset > 0;
-				++i
-			)
-		{
-			ASSERT(i != this->text().rend())
-			this->xOffset -= this->font().charAdvance(*i);
-			ASSERT(this->firstVisibleCharIndex > 0)
-			--this->firstVisibleCharIndex;
-		}
+		this->xOffset = this->cursorPos - (a[this->cursorIndex] - a[this->firstVisibleCharIndex]);
 	}
 }
 
 
 
 real TextInput::indexToPos(size_t index){
-	ASSERT(this->firstVisibleCharIndex <= this->text().size())
+	ASSERT(this->firstVisibleCharIndex <= this->textBuffer().size())
 	
 	if(index <= this->firstVisibleCharIndex){
 		return 0;
 	}
 	
-	utki::clampTop(index, this->text().size());
+	utki::clampTop(index, this->textBuffer().size());
 	
-	real ret = this->xOffset;
+	auto& a = this->advances();
+	ASSERT(index < a.size())
 	
-	for(auto i = this->text().begin() + this->firstVisibleCharIndex;
-			i != this->text().end() && index != this->firstVisibleCharIndex;
-			++i, --index
-		)
-	{
-		ret += this->font().charAdvance(*i);
-		if(ret >= this->rect().d.x){
-			ret = this->rect().d.x;
-			break;
-		}
-	}
+	real ret = this->xOffset + a[index] - a[this->firstVisibleCharIndex];
+	
+	utki::clampTop(ret, this->rect().d.x);
 	
 	return ret;
 }
 
 
 size_t TextInput::posToIndex(real pos){
-	size_t index = this->firstVisibleCharIndex;
-	real p = this->xOffset;
+	auto& a = this->advances();
+	ASSERT(this->firstVisibleCharIndex < a.size())
 	
-	for(auto i = this->text().begin() + this->firstVisibleCharIndex; i != this->text().end(); ++i){
-		real w = this->font().charAdvance(*i);
-		
-		if(pos < p + w){
-			if(pos < p + w / 2){
-				break;
-			}
-			p += w;
-			++index;
-			break;
-		}
-		
-		p += w;
-		++index;
+	//position relative to the beginning of the text
+	real p = pos - this->xOffset + a[this->firstVisibleCharIndex];
+	
+	//find first character, starting from first visible one, which ends after the position
+	auto i = std::upper_bound(a.begin() + this->firstVisibleCharIndex + 1, a.end(), p);
+	if(i == a.end()){
+		return this->textBuffer().size();
 	}
 	
-	return index;
+	size_t index = size_t(std::distance(a.begin(), i) - 1);
+	
+	if(p < (*(i - 1) + *i) / 2){
+		return index;
+	}
+	return index + 1;
 }
 
 
 void TextInput::update(std::uint32_t dt){
 	this->cursorBlinkVisible = !this->cursorBlinkVisible;
+	this->invalidate();
 }
 
 void TextInput::onFocusChanged(){
@@ -249,6 +246,7 @@ void TextInput::onFocusChanged(){
 		this->startCursorBlinking();
 	}else{
 		this->stopUpdating();
+		this->invalidate();
 	}
 }
 
@@ -260,6 +258,7 @@ void TextInput::onResize(){
 void TextInput::startCursorBlinking(){
 	this->stopUpdating();
 	this->cursorBlinkVisible = true;
+	this->invalidate();
 	this->startUpdating(cursorBlinkPeriod_c);
 }
 
@@ -284,13 +283,13 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 		case Key_e::ENTER:
 			break;
 		case Key_e::RIGHT:
-			if(this->cursorIndex != this->text().size()){
+			if(this->cursorIndex != this->textBuffer().size()){
 				size_t newIndex;
 				if(this->ctrlPressed){
 					bool spaceSkipped = false;
 					newIndex = this->cursorIndex;
-					for(auto i = this->text().begin() + this->cursorIndex; i != this->text().end(); ++i, ++newIndex){
-						if(*i == std::uint32_t(' ')){
+					for(; newIndex != this->textBuffer().size(); ++newIndex){
+						if(this->textBuffer()[newIndex] == std::uint32_t(' ')){
 							if(spaceSkipped){
 								break;
 							}
@@ -311,12 +310,8 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 				if(this->ctrlPressed){
 					bool spaceSkipped = false;
 					newIndex = this->cursorIndex;
-					for(auto i = this->text().rbegin() + (this->text().size() - this->cursorIndex);
-							i != this->text().rend();
-							++i, --newIndex
-						)
-					{
-						if(*i == std::uint32_t(' ')){
+					for(; newIndex != 0; --newIndex){
+						if(this->textBuffer()[newIndex - 1] == std::uint32_t(' ')){
 							if(spaceSkipped){
 								break;
 							}
@@ -331,7 +326,7 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 			}
 			break;
 		case Key_e::END:
-			this->setCursorIndex(this->text().size(), this->shiftPressed);
+			this->setCursorIndex(this->textBuffer().size(), this->shiftPressed);
 			break;
 		case Key_e::HOME:
 			this->setCursorIndex(0, this->shiftPressed);
@@ -341,9 +336,7 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 				this->setCursorIndex(this->deleteSelection());
 			}else{
 				if(this->cursorIndex != 0){
-					auto t = this->clear();
-					t.erase(t.begin() + (this->cursorIndex - 1));
-					this->setText(std::move(t));
+					this->eraseText(this->cursorIndex - 1, 1);
 					this->setCursorIndex(this->cursorIndex - 1);
 				}
 			}
@@ -352,10 +345,8 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 			if(this->thereIsSelection()){
 				this->setCursorIndex(this->deleteSelection());
 			}else{
-				if(this->cursorIndex < this->text().size()){
-					auto t = this->clear();
-					t.erase(t.begin() + this->cursorIndex);
-					this->setText(std::move(t));
+				if(this->cursorIndex < this->textBuffer().size()){
+					this->eraseText(this->cursorIndex, 1);
 				}
 			}
 			this->startCursorBlinking();
@@ -366,7 +357,7 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 		case Key_e::A:
 			if(this->ctrlPressed){
 				this->selectionStartIndex = 0;
-				this->setCursorIndex(this->text().size(), true);
+				this->setCursorIndex(this->textBuffer().size(), true);
 				break;
 			}
 			//fall through
@@ -376,9 +367,7 @@ void TextInput::onCharacterInput(const std::u32string& unicode, Key_e key){
 					this->cursorIndex = this->deleteSelection();
 				}
 				
-				auto t = this->clear();
-				t.insert(t.begin() + this->cursorIndex, unicode.begin(), unicode.end());
-				this->setText(std::move(t));
+				this->insertText(this->cursorIndex, unicode);
 				
 				this->setCursorIndex(this->cursorIndex + unicode.size());
 			}
@@ -403,9 +392,7 @@ size_t TextInput::deleteSelection(){
 		end = this->cursorIndex;
 	}
 	
-	auto t = this->clear();
-	t.erase(t.begin() + start, t.begin() + end);
-	this->setText(std::move(t));
+	this->eraseText(start, end - start);
 	
 	return start;
 }
@@ -0,0 +1,349 @@
+#include "TextView.hpp"
+
+#include "../Morda.hpp"
+
+#include "../util/util.hpp"
+
+#include <algorithm>
+
+
+
+using namespace morda;
+
+
+
+namespace{
+const size_t numWheelScrollLines_c = 3;
+}
+
+
+
+TextView::TextView(const stob::Node* chain) :
+		Widget(chain),
+		TextWidget(chain)
+{
+	this->setClip(true);
+
+	if(auto p = getProperty(chain, "text")){
+		this->append(unikod::toUtf32(p->value()));
+	}
+}
+
+
+
+morda::Vec2r TextView::measure(const morda::Vec2r& quotum)const{
+	//view does not need any minimal space, it only shows the rows which fit into it
+	Vec2r ret(quotum);
+	for(unsigned i = 0; i != ret.size(); ++i){
+		utki::clampBottom(ret[i], real(0));
+	}
+	return ret;
+}
+
+
+
+void TextView::wrapLine(size_t index){
+	ASSERT(index < this->lines.size())
+
+	auto& l = this->lines[index];
+
+	real width = this->rect().d.x;
+
+	if(l.wrapWidth == width && l.wrapLength == l.text.size()){
+		return;
+	}
+
+	size_t oldNumRows = l.numRows();
+
+	if(l.wrapWidth != width){
+		l.breaks.clear();
+	}
+
+	if(width > 0){
+		real advance = 0;
+
+		//breaks of the rows before the last one do not depend on the text appended to the line, so resume wrapping from the last row
+		size_t rowStart = l.breaks.size() == 0 ? 0 : l.breaks.back();
+
+		//index of the character after the last space in the current row
+		size_t wordStart = rowStart;
+
+		for(size_t i = rowStart; i != l.text.size(); ++i){
+			real a = this->font().charAdvance(l.text[i]);
+
+			if(advance + a > width && i != rowStart){
+				//break after the last space in the row, if any, otherwise break in the middle of the word
+				size_t b = wordStart > rowStart ? wordStart : i;
+				l.breaks.push_back(b);
+				rowStart = b;
+
+				advance = 0;
+				for(size_t j = b; j != i; ++j){
+					advance += this->font().charAdvance(l.text[j]);
+				}
+			}
+
+			advance += a;
+
+			if(l.text[i] == char32_t(' ')){
+				wordStart = i + 1;
+			}
+		}
+	}
+
+	l.wrapWidth = width;
+	l.wrapLength = l.text.size();
+
+	size_t numRows = l.numRows();
+	if(numRows != oldNumRows){
+		//for unsigned type the negative delta wraps around, which gives correct sums
+		this->rows.add(index, numRows - oldNumRows);
+	}
+}
+
+
+
+double TextView::scrollPos()const noexcept{
+	return double(this->rows.prefixSum(this->posIndex)) * double(this->lineHeight()) + double(this->posOffset);
+}
+
+
+
+double TextView::maxScrollPos()const noexcept{
+	double ret = double(this->rows.total()) * double(this->lineHeight()) - double(this->rect().d.y);
+	if(ret < 0){
+		return 0;
+	}
+	return ret;
+}
+
+
+
+void TextView::setScrollPos(double pos){
+	double lh = this->lineHeight();
+
+	if(this->lines.size() == 0 || lh <= 0){
+		this->posIndex = 0;
+		this->posOffset = 0;
+		return;
+	}
+
+	utki::clampRange(pos, 0.0, this->maxScrollPos());
+
+	this->posIndex = this->rows.upperBound(size_t(pos / lh));
+	utki::clampTop(this->posIndex, this->lines.size() - 1);
+
+	this->posOffset = real(pos - double(this->rows.prefixSum(this->posIndex)) * lh);
+}
+
+
+
+void TextView::updateVisibleRows(){
+	this->numVisibleRows = 0;
+	this->visibleRowsDirty = false;
+
+	real lh = this->lineHeight();
+	real h = this->rect().d.y;
+
+	if(this->lines.size() == 0 || lh <= 0){
+		return;
+	}
+
+	//wrap lines which are going to be visible, this changes number of rows of those lines,
+	//so scroll position has to be adjusted and more lines could become visible
+	for(bool wrapped = true; wrapped;){
+		wrapped = false;
+		real y = -this->posOffset;
+		for(size_t i = this->posIndex; i != this->lines.size() && y < h; ++i){
+			if(this->lines[i].wrapWidth != this->rect().d.x){
+				this->wrapLine(i);
+				wrapped = true;
+			}
+			y += real(this->lines[i].numRows()) * lh;
+		}
+		this->setScrollPos(this->scrollPos());
+	}
+
+	size_t rowInLine = size_t(this->posOffset / lh);
+	this->firstRowOffset = real(rowInLine) * lh - this->posOffset;
+
+	real y = this->firstRowOffset;
+	for(size_t i = this->posIndex; i != this->lines.size() && y < h; ++i, rowInLine = 0){
+		auto& l = this->lines[i];
+		for(size_t r = rowInLine; r < l.numRows() && y < h; ++r, y += lh){
+			size_t begin = r == 0 ? 0 : l.breaks[r - 1];
+			size_t end = r < l.breaks.size() ? l.breaks[r] : l.text.size();
+
+			this->rowBuf.assign(l.text, begin, end - begin);
+
+			if(this->numVisibleRows == this->visibleRows.size()){
+				this->visibleRows.emplace_back();
+			}
+			this->font().buildGlyphRun(this->visibleRows[this->numVisibleRows], this->rowBuf);
+			++this->numVisibleRows;
+		}
+	}
+}
+
+
+
+void TextView::layOut(){
+	this->updateVisibleRows();
+}
+
+
+
+void TextView::onFontChanged(){
+	//re-wrap lines when they become visible
+	for(auto& l : this->lines){
+		l.wrapWidth = real(-1);
+	}
+	this->setScrollPos(this->scrollPos());
+	this->setVisibleRowsDirty();
+}
+
+
+
+void TextView::render(const morda::Matr4r& matrix)const{
+	if(this->visibleRowsDirty){
+		const_cast<TextView*>(this)->updateVisibleRows();
+	}
+
+	PosTexShader& s = [this]() -> PosTexShader&{
+		if(this->color() == 0xffffffff){//if white
+			return morda::Morda::inst().shaders.posTexShader;
+		}else{
+			ColorPosTexShader& s = morda::Morda::inst().shaders.colorPosTexShader;
+
+			s.setColor(this->color());
+			return s;
+		}
+	}();
+
+	real lh = this->lineHeight();
+
+	for(size_t i = 0; i != this->numVisibleRows; ++i){
+		//widget's Y axis goes up, rows go from top to bottom
+		real bottom = this->rect().d.y - (this->firstRowOffset + real(i + 1) * lh);
+
+		morda::Matr4r matr(matrix);
+		matr.translate(0, bottom - this->font().boundingBox().p.y);
+
+		this->font().refreshGlyphRun(this->visibleRows[i]);
+		this->font().renderString(s, matr, this->visibleRows[i]);
+	}
+}
+
+
+
+bool TextView::onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_e button, unsigned pointerId){
+	if(!isDown){
+		return false;
+	}
+
+	switch(button){
+		case MouseButton_e::WHEEL_UP:
+			this->scrollBy(-real(numWheelScrollLines_c) * this->lineHeight());
+			return true;
+		case MouseButton_e::WHEEL_DOWN:
+			this->scrollBy(real(numWheelScrollLines_c) * this->lineHeight());
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+
+void TextView::append(const std::u32string& text){
+	if(text.size() == 0){
+		return;
+	}
+
+	bool stickToEnd = this->isScrolledToEnd();
+
+	if(this->lines.size() == 0){
+		this->lines.emplace_back();
+		this->rows.push_back(1);
+	}
+
+	size_t firstChanged = this->lines.size() - 1;
+
+	for(auto i = text.begin();;){
+		auto nl = std::find(i, text.end(), char32_t('\n'));
+
+		auto& l = this->lines.back();
+		l.text.append(i, nl);
+
+		if(nl == text.end()){
+			break;
+		}
+
+		this->lines.emplace_back();
+		this->rows.push_back(1);
+
+		i = std::next(nl);
+	}
+
+	for(size_t i = firstChanged; i != this->lines.size(); ++i){
+		this->wrapLine(i);
+	}
+
+	if(stickToEnd){
+		this->setScrollPos(this->maxScrollPos());
+		this->setVisibleRowsDirty();
+		return;
+	}
+
+	//visible rows are affected only if the first changed line starts above the bottom edge of the view
+	if(double(this->rows.prefixSum(firstChanged)) * double(this->lineHeight()) < this->scrollPos() + double(this->rect().d.y)){
+		this->setVisibleRowsDirty();
+	}
+}
+
+
+
+void TextView::clear(){
+	this->lines.clear();
+	this->rows.clear();
+	this->posIndex = 0;
+	this->posOffset = 0;
+	this->setVisibleRowsDirty();
+}
+
+
+
+void TextView::scrollBy(real delta){
+	this->setScrollPos(this->scrollPos() + double(delta));
+	this->setVisibleRowsDirty();
+}
+
+
+
+void TextView::scrollToEnd(){
+	this->setScrollPos(this->maxScrollPos());
+	this->setVisibleRowsDirty();
+}
+
+
+
+bool TextView::isScrolledToEnd()const noexcept{
+	return this->scrollPos() >= this->maxScrollPos();
+}
+
+
+
+void TextView::setScrollPosAsFactor(real factor){
+	this->setScrollPos(double(factor) * this->maxScrollPos());
+	this->setVisibleRowsDirty();
+}
+
+
+
+real TextView::scrollFactor()const noexcept{
+	double max = this->maxScrollPos();
+	if(max <= 0){
+		return 0;
+	}
+	return real(this->scrollPos() / max);
+}
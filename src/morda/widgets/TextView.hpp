@@ -0,0 +1,175 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+
+#include "core/Widget.hpp"
+#include "TextWidget.hpp"
+
+#include "../util/FenwickTree.hpp"
+
+
+namespace morda{
+
+/**
+ * @brief Multi-line text view widget.
+ * The widget is intended for showing large amounts of text, like logs or console output.
+ * Text is stored as lines in chunked storage, so appending text costs amortized O(1) per character.
+ * Lines are word wrapped to the widget width. Wrapping is incremental: appended text is wrapped
+ * when added, resuming from the last row of the line, other lines are re-wrapped after width or
+ * font change when they become visible.
+ * Number of rows of each line is kept in a binary indexed tree, so that mapping scroll position
+ * to a line is O(log n). Only the visible rows are laid out into glyph runs and rendered, they are
+ * laid out once before rendering, and only if the changes of the text or scroll position affect them.
+ * If the view is scrolled to the end of the text, it stays there when text is appended.
+ * From GUI script it can be instantiated as "TextView".
+ *
+ * @param text - initial text of the view.
+ */
+class TextView : public TextWidget{
+	struct Line{
+		std::u32string text;
+
+		//indices of characters starting wrapped rows, except the first row which always starts at 0
+		std::vector<size_t> breaks;
+
+		//width the line was wrapped for, negative if line needs re-wrapping
+		real wrapWidth = real(-1);
+
+		//number of characters of the line which were wrapped, text appended after those is wrapped starting from the last row
+		size_t wrapLength = 0;
+
+		size_t numRows()const noexcept{
+			return this->breaks.size() + 1;
+		}
+	};
+
+	std::deque<Line> lines;
+
+	//number of rows of each line
+	FenwickTree<size_t> rows;
+
+	//scroll position, index of the line at the top of the view and offset from the top of that line in pixels
+	size_t posIndex = 0;
+	real posOffset = real(0);
+
+	//glyph runs of the visible rows, from top to bottom
+	mutable std::vector<Font::GlyphRun> visibleRows;
+	size_t numVisibleRows = 0;
+
+	//visible rows are laid out before rendering if this flag is set
+	bool visibleRowsDirty = false;
+
+	//offset of the first visible row from the top of the widget, zero or negative
+	real firstRowOffset = real(0);
+
+	std::u32string rowBuf;
+
+	real lineHeight()const noexcept{
+		return this->font().boundingBox().d.y;
+	}
+
+	void wrapLine(size_t index);
+
+	void setScrollPos(double pos);
+
+	double scrollPos()const noexcept;
+
+	double maxScrollPos()const noexcept;
+
+	void updateVisibleRows();
+
+	void setVisibleRowsDirty(){
+		this->visibleRowsDirty = true;
+		this->invalidate();
+	}
+
+public:
+	TextView(const stob::Node* chain = nullptr);
+
+	TextView(const TextView&) = delete;
+	TextView& operator=(const TextView&) = delete;
+
+	morda::Vec2r measure(const morda::Vec2r& quotum)const override;
+
+	void layOut()override;
+
+	void render(const morda::Matr4r& matrix)const override;
+
+	bool onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_e button, unsigned pointerId)override;
+
+	void onFontChanged()override;
+
+	/**
+	 * @brief Append text.
+	 * Text is appended to the last line, each new line character starts a new line.
+	 * @param text - text to append.
+	 */
+	void append(const std::u32string& text);
+
+	/**
+	 * @brief Append text.
+	 * @param text - UTF-8 text to append.
+	 */
+	void append(const std::string& text){
+		this->append(unikod::toUtf32(text));
+	}
+
+	/**
+	 * @brief Remove all text.
+	 */
+	void clear();
+
+	/**
+	 * @brief Get number of lines.
+	 * @return Number of lines of text.
+	 */
+	size_t numLines()const noexcept{
+		return this->lines.size();
+	}
+
+	/**
+	 * @brief Get line of text.
+	 * @param index - index of the line.
+	 * @return Text of the line.
+	 */
+	const std::u32string& line(size_t index)const{
+		ASSERT(index < this->lines.size())
+		return this->lines[index].text;
+	}
+
+	/**
+	 * @brief Scroll the view.
+	 * @param delta - distance to scroll in pixels, positive values scroll towards the end of the text.
+	 */
+	void scrollBy(real delta);
+
+	/**
+	 * @brief Scroll to the end of the text.
+	 */
+	void scrollToEnd();
+
+	/**
+	 * @brief Check if the view is scrolled to the end of the text.
+	 * @return true if the last row of the text is visible.
+	 * @return false otherwise.
+	 */
+	bool isScrolledToEnd()const noexcept;
+
+	/**
+	 * @brief Set scroll position as factor from [0:1].
+	 * Heights of the lines which were not wrapped for the current width are estimated
+	 * from their previous wrapping, so the position is approximate after width change.
+	 * @param factor - factor of the scroll position to set.
+	 */
+	void setScrollPosAsFactor(real factor);
+
+	/**
+	 * @brief Get scroll factor.
+	 * @return Current scroll position as factor from [0:1].
+	 */
+	real scrollFactor()const noexcept;
+};
+
+}
@@ -32,6 +32,119 @@ SingleLineTextWidget::SingleLineTextWidget(const stob::Node* chain) :
 
 
 
+Rectr SingleLineTextWidget::spanBoundingBox(size_t begin, size_t end)const{
+	ASSERT(begin <= end)
+	ASSERT(end <= this->buffer_v.size())
+	ASSERT(this->advances().size() == this->buffer_v.size() + 1)
+	
+	if(begin == end){
+		return Rectr(Vec2r(0), Vec2r(0));
+	}
+	
+	Vec2r min, max;
+	for(size_t i = begin; i != end; ++i){
+		auto r = this->font().charBoundingBox(this->buffer_v[i]);
+		r.p.x += this->advances()[i];
+		
+		if(i == begin){
+			min = r.p;
+			max = r.p + r.d;
+			continue;
+		}
+		
+		for(unsigned j = 0; j != 2; ++j){
+			utki::clampTop(min[j], r.p[j]);
+			utki::clampBottom(max[j], r.p[j] + r.d[j]);
+		}
+	}
+	
+	return Rectr(min, max - min);
+}
+
+
+
+void SingleLineTextWidget::onTextEdited(const Vec2r& oldMinDim){
+	this->textDirty = true;
+	
+	this->invalidate();
+	
+	//measured dimensions for any quotum are determined by minimal dimensions, so no need to re-layout if those did not change
+	if(this->measure(Vec2r(-1)) != oldMinDim){
+		this->setRelayoutNeeded();
+	}
+}
+
+
+
+void SingleLineTextWidget::insertText(size_t pos, const std::u32string& str){
+	ASSERT(pos <= this->buffer_v.size())
+	
+	if(str.size() == 0){
+		return;
+	}
+	
+	auto oldMinDim = this->measure(Vec2r(-1));
+	
+	bool wasEmpty = this->buffer_v.size() == 0;
+	
+	this->buffer_v.insert(pos, str.data(), str.size());
+	
+	//builds geometry and advances of inserted characters only, and shifts the characters after them
+	this->font().insertIntoGlyphRun(this->glyphRun_v, pos, str);
+	
+	if(wasEmpty){
+		this->bb = this->spanBoundingBox(pos, pos + str.size());
+	}else if(pos + str.size() == this->buffer_v.size()){
+		//appended characters do not move the other ones, so the bounding box just grows to include them
+		auto r = this->spanBoundingBox(pos, pos + str.size());
+		Vec2r min = this->bb.p;
+		Vec2r max = this->bb.p + this->bb.d;
+		for(unsigned i = 0; i != 2; ++i){
+			utki::clampTop(min[i], r.p[i]);
+			utki::clampBottom(max[i], r.p[i] + r.d[i]);
+		}
+		this->bb = Rectr(min, max - min);
+	}else{
+		//characters after the inserted ones have moved, any of them could define the left or right edge
+		this->recomputeBoundingBox();
+	}
+	
+	this->onTextEdited(oldMinDim);
+}
+
+
+
+void SingleLineTextWidget::eraseText(size_t pos, size_t n){
+	ASSERT(pos <= this->buffer_v.size())
+	utki::clampTop(n, this->buffer_v.size() - pos);
+	
+	if(n == 0){
+		return;
+	}
+	
+	auto oldMinDim = this->measure(Vec2r(-1));
+	
+	auto r = this->spanBoundingBox(pos, pos + n);
+	
+	this->buffer_v.erase(pos, n);
+	
+	this->font().eraseFromGlyphRun(this->glyphRun_v, pos, n);
+	
+	if(this->buffer_v.size() == 0){
+		this->bb = Rectr(Vec2r(0), Vec2r(0));
+	}else if(pos != this->buffer_v.size()
+			|| r.p.x <= this->bb.p.x || r.p.x + r.d.x >= this->bb.p.x + this->bb.d.x
+			|| r.p.y <= this->bb.p.y || r.p.y + r.d.y >= this->bb.p.y + this->bb.d.y)
+	{
+		//characters after the erased ones have moved or the erased characters could define an edge
+		this->recomputeBoundingBox();
+	}
+	
+	this->onTextEdited(oldMinDim);
+}
+
+
+
 Vec2r SingleLineTextWidget::measure(const morda::Vec2r& quotum)const noexcept{
 	Vec2r ret(this->bb.d.x, this->font().boundingBox().d.y - this->font().boundingBox().p.y);
 	
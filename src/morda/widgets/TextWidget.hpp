@@ -5,6 +5,8 @@
 
 #include "../resources/ResFont.hpp"
 
+#include "../util/GapBuffer.hpp"
+
 #include <kolme/Rectangle.hpp>
 
 #include <list>
@@ -49,10 +51,21 @@ private:
 
 
 class SingleLineTextWidget : public TextWidget{
-	std::u32string text_v;
+	GapBuffer<char32_t> buffer_v;
+	
+	//contiguous copy of the text, updated on request after editing
+	mutable std::u32string text_v;
+	mutable bool textDirty = false;
 	
 	mutable Rectr bb;
 	
+	//retained geometry of the text, edited in place along with the text
+	mutable Font::GlyphRun glyphRun_v;
+	
+	Rectr spanBoundingBox(size_t begin, size_t end)const;
+	
+	void onTextEdited(const Vec2r& oldMinDim);
+	
 protected:
 	Vec2r measure(const morda::Vec2r& quotum)const noexcept override;
 	
@@ -62,14 +75,63 @@ protected:
 		return this->bb;
 	}
 	
+	const Font::GlyphRun& glyphRun()const{
+		this->font().refreshGlyphRun(this->glyphRun_v);
+		return this->glyphRun_v;
+	}
+	
 	void recomputeBoundingBox(){
-		this->bb = this->font().stringBoundingBox(this->text_v);
+		this->bb = this->spanBoundingBox(0, this->buffer_v.size());
 	}
+	
+	/**
+	 * @brief Get prefix sums of character advances.
+	 * Element with index i is the advance of the first i characters of the text,
+	 * so the array has one element more than there are characters in the text.
+	 * @return Array of advance prefix sums.
+	 */
+	const std::vector<real>& advances()const noexcept{
+		return this->glyphRun_v.advances;
+	}
+	
+	/**
+	 * @brief Get editable text buffer.
+	 * Accessing characters through the buffer does not require the contiguous copy of the text after editing.
+	 * @return Text buffer.
+	 */
+	const GapBuffer<char32_t>& textBuffer()const noexcept{
+		return this->buffer_v;
+	}
+	
+	/**
+	 * @brief Insert text.
+	 * Glyph run and advances are updated only for the edited span of the text. Bounding box is
+	 * recalculated for the whole text only if the text was inserted before its end.
+	 * The widget is re-laid out only if its minimal dimensions have changed.
+	 * @param pos - index of the character to insert the text at.
+	 * @param str - text to insert.
+	 */
+	void insertText(size_t pos, const std::u32string& str);
+	
+	/**
+	 * @brief Erase part of the text.
+	 * Glyph run and advances are updated only for the edited span of the text. Bounding box is
+	 * recalculated for the whole text only if the text was erased before its end or the erased
+	 * characters could define an edge of the bounding box.
+	 * The widget is re-laid out only if its minimal dimensions have changed.
+	 * @param pos - index of the first character to erase.
+	 * @param n - number of characters to erase.
+	 */
+	void eraseText(size_t pos, size_t n);
 public:
 	
 	void setText(decltype(text_v)&& text){
+		this->buffer_v.assign(text.begin(), text.end());
 		this->text_v = std::move(text);
+		this->textDirty = false;
 		this->setRelayoutNeeded();
+		this->invalidate();
+		this->font().buildGlyphRun(this->glyphRun_v, this->text_v);
 		this->recomputeBoundingBox();
 	}
 	
@@ -78,15 +140,31 @@ public:
 	}
 
 	void onFontChanged()override{
+		this->font().buildGlyphRun(this->glyphRun_v, this->text());
 		this->recomputeBoundingBox();
 	}
 
 	
 	decltype(text_v) clear(){
-		return std::move(this->text_v);
+		this->text();
+		auto ret = std::move(this->text_v);
+		this->text_v.clear();
+		this->buffer_v.clear();
+		this->glyphRun_v.verts.clear();
+		this->glyphRun_v.texCoords.clear();
+		this->glyphRun_v.pages.clear();
+		this->glyphRun_v.charQuads.resize(1);
+		this->glyphRun_v.advances.resize(1);
+		this->glyphRun_v.text.clear();
+		this->glyphRun_v.advance = 0;
+		return ret;
 	}
 	
-	const decltype(text_v)& text()const noexcept{
+	const decltype(text_v)& text()const{
+		if(this->textDirty){
+			this->buffer_v.copyTo(this->text_v);
+			this->textDirty = false;
+		}
 		return this->text_v;
 	}
 };
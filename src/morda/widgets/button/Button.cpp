@@ -23,11 +23,13 @@ bool Button::onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_e b
 		//then the event about left button down will still be delivered to this widget because it has captured the mouse.
 		if(this->contains(pos)){
 			this->isPressed_v = true;
+			this->invalidate();
 			this->onPressedChanged();
 		}
 	}else{
 		if(this->isPressed_v){
 			this->isPressed_v = false;
+			this->invalidate();
 			this->onPressedChanged();
 	//		TRACE(<< "AbstractButton::OnMouseButton(): emitting signal" << std::endl)
 		}
@@ -46,6 +48,7 @@ void Button::onHoverChanged(unsigned pointerId){
 	if(!this->isHovered(pointerId)){
 		if(this->isPressed_v){
 			this->isPressed_v = false;
+			this->invalidate();
 			this->onPressedChanged();
 		}
 	}
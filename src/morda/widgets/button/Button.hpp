@@ -126,6 +126,7 @@ public:
 		}
 		
 		this->isChecked_v = checked;
+		this->invalidate();
 		this->onCheckedChanged();
 	}
 	
@@ -22,6 +22,7 @@ void ChoiceButton::setChecked(bool checked) {
 	}
 	
 	this->isChecked_v = checked;
+	this->invalidate();
 	this->onCheckedChanged();
 }
 
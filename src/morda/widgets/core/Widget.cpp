@@ -1,3 +1,5 @@
+#include <array>
+
 #include "../../shaders/PosShader.hpp"
 
 #include "../../render/FrameBuffer.hpp"
@@ -16,6 +18,10 @@ using namespace morda;
 
 
 
+kolme::Recti Widget::curClipRect;
+
+
+
 Widget::Widget(const stob::Node* chain){
 	if(const stob::Node* n = getProperty(chain, "layout")){
 		this->layout = n->cloneChain();
@@ -55,6 +61,12 @@ Widget::Widget(const stob::Node* chain){
 		this->clip_v = false;
 	}
 	
+	if(const stob::Node* p = getProperty(chain, "cull")){
+		this->cull_v = p->asBool();
+	}else{
+		this->cull_v = true;
+	}
+	
 	if(const stob::Node* p = getProperty(chain, "cache")){
 		this->cache = p->asBool();
 	}else{
@@ -92,6 +104,17 @@ Widget::LayoutParams::LayoutParams(const stob::Node* chain){
 
 
 
+Widget::~Widget()noexcept{
+	//return cache texture to the pool, so that it is re-used by other cached widgets
+	if(this->cacheTex){
+		try{
+			Morda::inst().renderTargets.releaseTexture(std::move(this->cacheTex));
+		}catch(...){}
+	}
+}
+
+
+
 std::shared_ptr<Widget> Widget::findChildByName(const std::string& name)noexcept{
 	if(this->name() == name){
 		return this->sharedFromThis(this);
@@ -104,7 +127,7 @@ std::shared_ptr<Widget> Widget::findChildByName(const std::string& name)noexcept
 void Widget::resize(const morda::Vec2r& newDims){
 	if(this->rectangle.d == newDims){
 		if(this->relayoutNeeded){
-			this->clearCache();
+			//NOTE: do not damage the whole widget, children which change their size or position during layout damage the affected areas
 			this->relayoutNeeded = false;
 			this->layOut();
 		}
@@ -115,6 +138,8 @@ void Widget::resize(const morda::Vec2r& newDims){
 	this->rectangle.d = newDims;
 	utki::clampBottom(this->rectangle.d.x, real(0.0f));
 	utki::clampBottom(this->rectangle.d.y, real(0.0f));
+	this->clearCache();//damage new area
+	this->onRectChangedInternal();
 	this->relayoutNeeded = false;
 	this->onResize();//call virtual method
 }
@@ -131,14 +156,13 @@ std::shared_ptr<Widget> Widget::removeFromParent(){
 
 
 void Widget::setRelayoutNeeded()noexcept{
-	if(this->relayoutNeeded){
-		return;
-	}
-	this->relayoutNeeded = true;
-	if(this->parentContainer){
-		this->parentContainer->setRelayoutNeeded();
+	//NOTE: only this widget is damaged here, re-layout is done before rendering,
+	//      so other areas affected by it will be damaged by resizing and moving of widgets during layout
+	this->invalidate();
+	
+	for(Widget* w = this; w && !w->relayoutNeeded; w = w->parentContainer){
+		w->relayoutNeeded = true;
 	}
-	this->cacheTex = Texture2D();
 }
 
 
@@ -153,14 +177,17 @@ void Widget::renderInternal(const morda::Matr4r& matrix)const{
 			bool scissorTestWasEnabled = Render::isScissorEnabled();
 			Render::setScissorEnabled(false);
 
-			//check if can re-use old texture
-			if(!this->cacheTex || this->cacheTex.dim() != this->rect().d){
-				this->cacheTex = this->renderToTexture();
-			}else{
-				ASSERT(this->cacheTex.dim() == this->rect().d)
-				this->cacheTex = this->renderToTexture(std::move(this->cacheTex));
+			auto& pool = Morda::inst().renderTargets;
+			
+			//check if can re-use old texture, it is re-used as long as the widget fits the same size bucket
+			auto bucketDim = RenderTargetPool::bucketDim(this->rect().d.to<unsigned>());
+			if(!this->cacheTex || this->cacheTex.dim().to<unsigned>() != bucketDim){
+				pool.releaseTexture(std::move(this->cacheTex));
+				this->cacheTex = pool.acquireTexture(bucketDim);
 			}
 			
+			this->cacheTex = this->renderToTextureInternal(std::move(this->cacheTex));
+			
 			Render::setScissorEnabled(scissorTestWasEnabled);
 			this->cacheDirty = false;
 		}
@@ -186,8 +213,13 @@ void Widget::renderInternal(const morda::Matr4r& matrix)const{
 			}
 
 			Render::setScissorRect(scissor);
+			
+			kolme::Recti oldClipRect = curClipRect;
+			curClipRect.intersect(scissor);
 
 			this->render(matrix);
+			
+			curClipRect = oldClipRect;
 
 			if(scissorTestWasEnabled){
 				Render::setScissorRect(oldScissor);
@@ -230,24 +262,36 @@ Texture2D Widget::renderToTexture(Texture2D&& reuse) const {
 			);
 	}
 	
+	return this->renderToTextureInternal(std::move(tex));
+}
+
+Texture2D Widget::renderToTextureInternal(Texture2D&& tex) const {
+	ASSERT(tex)
+	ASSERT(tex.dim().x >= this->rect().d.x && tex.dim().y >= this->rect().d.y)
+	
 	Render::unbindTexture(0);
 	
-	FrameBuffer fb;
+	auto& pool = Morda::inst().renderTargets;
+	
+	auto fb = pool.acquireFrameBuffer();
 	
-	fb.bind();
+	fb->bind();
 	
-	fb.attachColor(std::move(tex));
+	fb->attachColor(std::move(tex));
 	
-	ASSERT(fb.isComplete())
+	ASSERT(fb->isComplete())
 	
-	ASSERT_INFO(Render::isBoundFrameBufferComplete(), "tex.dim() = " << tex.dim())
+	ASSERT_INFO(Render::isBoundFrameBufferComplete(), "this->rect().d = " << this->rect().d)
 	
 	auto oldViewport = Render::getViewport();
-	utki::ScopeExit scopeExit([&oldViewport](){
+	auto oldClipRect = curClipRect;
+	utki::ScopeExit scopeExit([&oldViewport, &oldClipRect](){
 		Render::setViewport(oldViewport);
+		curClipRect = oldClipRect;
 	});
 	
 	Render::setViewport(kolme::Recti(kolme::Vec2i(0), this->rect().d.to<int>()));
+	curClipRect = Render::getViewport();
 	
 	Render::clearColor(kolme::Vec4f(0.0f));
 	
@@ -258,11 +302,13 @@ Texture2D Widget::renderToTexture(Texture2D&& reuse) const {
 	
 	this->render(matrix);
 	
-	tex = fb.detachColor();
+	tex = fb->detachColor();
 	
-	fb.unbind();
+	fb->unbind();
 	
-	return tex;
+	pool.releaseFrameBuffer(std::move(fb));
+	
+	return std::move(tex);
 }
 
 void Widget::renderFromCache(const kolme::Matr4f& matrix) const {
@@ -276,17 +322,48 @@ void Widget::renderFromCache(const kolme::Matr4f& matrix) const {
 	
 	s.setMatrix(matr);
 	
-	s.render(utki::wrapBuf(morda::PosShader::quad01Fan), utki::wrapBuf(s.quadFanTexCoords));
+	//cache texture can be bigger than the widget, widget is rendered to its lower left corner
+	Vec2r t = this->rect().d.compDiv(this->cacheTex.dim());
+	std::array<kolme::Vec2f, 4> texCoords = {{
+		kolme::Vec2f(0, 0), kolme::Vec2f(t.x, 0), kolme::Vec2f(t.x, t.y), kolme::Vec2f(0, t.y)
+	}};
+	
+	s.render(utki::wrapBuf(morda::PosShader::quad01Fan), utki::wrapBuf(texCoords));
 }
 
 void Widget::clearCache(){
+	this->clearCache(Rectr(Vec2r(0), this->rect().d));
+}
+
+
+
+void Widget::clearCache(Rectr damage){
 	this->cacheDirty = true;
+	
+	damage.p += this->rect().p;
+	
 	if(this->parentContainer){
-		this->parentContainer->clearCache();
+		this->parentContainer->clearCache(this->parentContainer->childDamageToLocal(damage));
+	}else{
+		Morda::inst().addDamage(damage);
+	}
+}
+
+
+
+void Widget::onRectChangedInternal()noexcept{
+	if(this->parentContainer && this->parentContainer->spatialIndex){
+		this->parentContainer->spatialIndex->dirty = true;
 	}
 }
 
 
+
+void Widget::invalidate()noexcept{
+	this->clearCache();
+}
+
+
 void Widget::onKeyInternal(bool isDown, Key_e keyCode){
 	if(this->isInteractive()){
 		if(this->onKey(isDown, keyCode)){
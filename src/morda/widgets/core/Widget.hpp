@@ -38,6 +38,8 @@ class Container;
  * @param dy - height of the widget.
  * @param name - name assigned to widget.
  * @param clip - enable (true) or disable (false) the scissor test for this widget boundaries when rendering. Default value is false.
+ * @param cull - enable (true) or disable (false) skipping rendering of the widget when it is entirely out of current clipping area. Default value is true.
+ *               Disable it for widgets which intentionally draw outside of their boundaries.
  * @param cache - enable (true) or disable (false) pre-rendering this widget to texture and render from texture for faster rendering.
  * @param visible - should the widget be initially visible (true) or hidden (false). Default value is true.
  * @param enabled - should the widget be initially enabled (true) or disabled (false). Default value is true. Disabled widgets do not get any input from keyboard or mouse.
@@ -103,6 +105,13 @@ private:
 	
 	//clip widgets contents by widget's border if set to true
 	bool clip_v;
+	
+	//skip rendering of the widget if it is out of current clipping area
+	bool cull_v;
+	
+	//Clipping area of the widget being currently rendered, in viewport pixels.
+	//It is tracked along with scissor test, but also when the scissor test is not enabled.
+	static kolme::Recti curClipRect;
 public:
 	/**
 	 * @brief Check if scissor test is enabled for this widget.
@@ -121,18 +130,58 @@ public:
 		this->clip_v = clip;
 	}
 	
+	/**
+	 * @brief Check if culling is enabled for this widget.
+	 * If culling is enabled then the widget is not rendered when it is entirely out of current clipping area.
+	 * @return true if culling is enabled.
+	 * @return false otherwise.
+	 */
+	bool cull()const noexcept{
+		return this->cull_v;
+	}
+	
+	/**
+	 * @brief Enable/Disable culling.
+	 * Culling should be disabled for widgets which draw outside of their boundaries.
+	 * @param cull - whether to enable (true) or disable (false) the culling.
+	 */
+	void setCull(bool cull)noexcept{
+		this->cull_v = cull;
+	}
+	
 	
 private:
 	bool cache;
 	mutable bool cacheDirty = true;
+	
+	//texture from the render target pool, can be bigger than the widget
 	mutable Texture2D cacheTex;
 
 	void renderFromCache(const kolme::Matr4f& matrix)const;
 	
+	//renders the widget to lower left corner of the texture, texture should not be smaller than the widget
+	Texture2D renderToTextureInternal(Texture2D&& tex)const;
+	
+	//notifies parent container that position or size of the widget has changed
+	void onRectChangedInternal()noexcept;
+	
 protected:
 	void clearCache();
 	
+	//damage is in this widget's coordinates
+	void clearCache(Rectr damage);
+	
 public:
+	/**
+	 * @brief Request redrawing of the widget.
+	 * Call this method whenever the appearance of the widget changes without changing its layout,
+	 * for example when the widget is animated from Updateable::update().
+	 * It marks cached contents of the widget and its ancestors as outdated and
+	 * reports the widget's rectangle as damaged, see Morda::needsRedraw() and Morda::damage().
+	 */
+	void invalidate()noexcept;
+	
+
 	/**
 	 * @brief Render this widget to texture.
 	 * @param reuse - try to re-use the existing texture to avoid new texture allocation.
@@ -274,7 +323,13 @@ public:
 	 * @param newPos - new widget's position.
 	 */
 	void moveTo(const morda::Vec2r& newPos)noexcept{
+		if(this->rectangle.p == newPos){
+			return;
+		}
+		this->invalidate();//damage old position
 		this->rectangle.p = newPos;
+		this->invalidate();
+		this->onRectChangedInternal();
 	}
 	
 	/**
@@ -282,7 +337,7 @@ public:
 	 * @param delta - vector to shift the widget by.
 	 */
 	void moveBy(const morda::Vec2r& delta)noexcept{
-		this->rectangle.p += delta;
+		this->moveTo(this->rectangle.p + delta);
 	}
 
 	/**
@@ -330,7 +385,7 @@ public:
 	
 public:
 
-	virtual ~Widget()noexcept{}
+	virtual ~Widget()noexcept;
 
 	/**
 	 * @brief Render widget to screen.
@@ -467,10 +522,14 @@ public:
 	 * @param visible - whether to show (true) or hide (false) the widget.
 	 */
 	void setVisible(bool visible){
+		if(this->isVisible_v == visible){
+			return;
+		}
 		this->isVisible_v = visible;
 		if(!this->isVisible_v){
 			this->setUnhovered();
 		}
+		this->invalidate();
 	}
 	
 	/**
@@ -1,5 +1,8 @@
 #include "Container.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "../../../Morda.hpp"
 
 #include "../../../util/util.hpp"
@@ -24,6 +27,19 @@ public:
 		this->blocked = false;
 	}
 };
+
+//desired average number of children per spatial index cell
+const real childrenPerCell_c = 4;
+
+const unsigned maxCellsPerAxis_c = 256;
+
+unsigned cellIndex(real v, real begin, real cellDim, unsigned numCells){
+	if(cellDim <= 0){
+		return 0;
+	}
+	int i = int(std::floor((v - begin) / cellDim));
+	return unsigned(std::min(std::max(i, 0), int(numCells) - 1));
+}
 }
 
 
@@ -31,6 +47,10 @@ public:
 Container::Container(const stob::Node* chain) :
 		Widget(chain)
 {
+	if(auto p = getProperty(chain, "spatialIndex")){
+		this->setSpatialIndexEnabled(p->asBool());
+	}
+	
 	if(chain){
 		this->add(*chain);
 	}
@@ -79,6 +99,11 @@ void Container::render(const morda::Matr4r& matrix)const{
 		
 		morda::Matr4r matr(matrix);
 		matr.translate(w->rect().p);
+		
+		//skip children which are entirely out of clipping area
+		if(w->cull() && !overlap(w->computeViewportRect(matr), Widget::curClipRect)){
+			continue;
+		}
 
 		w->renderInternal(matr);
 	}
@@ -96,7 +121,7 @@ bool Container::onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_
 		T_MouseCaptureMap::iterator i = this->mouseCaptureMap.find(pointerID);
 		if(i != this->mouseCaptureMap.end()){
 			if(auto w = i->second.first.lock()){
-				w->setHovered(w->rect().overlaps(pos), pointerID);
+				this->setChildHovered(*w, w->rect().overlaps(pos), pointerID);
 				w->onMouseButton(isDown, pos - w->rect().p, button, pointerID);
 				
 				unsigned& n = i->second.second;
@@ -115,28 +140,47 @@ bool Container::onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_
 		}
 	}
 	
-	//call children in reverse order
-	for(Widget::T_ChildrenList::const_reverse_iterator i = this->children().rbegin(); i != this->children().rend(); ++i){
-		if(!(*i)->isInteractive()){
-			continue;
+	auto dispatch = [&](const std::shared_ptr<Widget>& w) -> bool{
+		if(!w->isInteractive()){
+			return false;
 		}
 		
-		if(!(*i)->rect().overlaps(pos)){
-			continue;
+		if(!w->rect().overlaps(pos)){
+			return false;
 		}
 		
 		//Sometimes mouse click event comes without prior mouse move,
 		//but, since we get mouse click, then the widget was hovered before the click.
-		(*i)->setHovered(true, pointerID);
-		if((*i)->onMouseButton(isDown, pos - (*i)->rect().p, button, pointerID)){
+		this->setChildHovered(*w, true, pointerID);
+		if(w->onMouseButton(isDown, pos - w->rect().p, button, pointerID)){
 			ASSERT(this->mouseCaptureMap.find(pointerID) == this->mouseCaptureMap.end())
 			
 			if(isDown){//in theory, it can be button up event here, if some widget which captured mouse was removed from its parent
-				this->mouseCaptureMap.insert(std::make_pair(pointerID, std::make_pair(std::weak_ptr<Widget>(*i), 1)));
+				this->mouseCaptureMap.insert(std::make_pair(pointerID, std::make_pair(std::weak_ptr<Widget>(w), 1)));
 			}
 			
 			return true;
 		}
+		return false;
+	};
+	
+	if(this->spatialIndex){
+		if(this->spatialIndex->dirty){
+			this->spatialIndex->rebuild(this->children());
+		}
+		
+		for(auto z : this->spatialIndex->query(pos)){
+			if(dispatch(*this->spatialIndex->children[z]->parentIter)){
+				return true;
+			}
+		}
+	}else{
+		//call children in reverse order
+		for(Widget::T_ChildrenList::const_reverse_iterator i = this->children().rbegin(); i != this->children().rend(); ++i){
+			if(dispatch(*i)){
+				return true;
+			}
+		}
 	}
 	
 	return this->Widget::onMouseButton(isDown, pos, button, pointerID);
@@ -149,6 +193,10 @@ bool Container::onMouseMove(const morda::Vec2r& pos, unsigned pointerID){
 	
 	BlockedFlagGuard blockedFlagGuard(this->isBlocked);
 	
+	if(this->spatialIndex){
+		return this->onMouseMoveIndexed(pos, pointerID);
+	}
+	
 	//call children in reverse order
 	for(Widget::T_ChildrenList::const_reverse_iterator i = this->children().rbegin(); i != this->children().rend(); ++i){
 		if(!(*i)->isInteractive()){
@@ -188,6 +236,20 @@ void Container::onHoverChanged(unsigned pointerID){
 	
 	//un-hover all the children if container became un-hovered
 	BlockedFlagGuard blockedFlagGuard(this->isBlocked);
+	
+	if(this->spatialIndex){
+		auto i = this->spatialIndex->hovered.find(pointerID);
+		if(i == this->spatialIndex->hovered.end()){
+			return;
+		}
+		auto hovered = std::move(i->second);
+		this->spatialIndex->hovered.erase(i);
+		for(auto w : hovered){
+			w->setHovered(false, pointerID);
+		}
+		return;
+	}
+	
 	for(auto& w : this->children()){
 		w->setHovered(false, pointerID);
 	}
@@ -195,8 +257,213 @@ void Container::onHoverChanged(unsigned pointerID){
 
 
 
+bool Container::onMouseMoveIndexed(const morda::Vec2r& pos, unsigned pointerID){
+	ASSERT(this->spatialIndex)
+	auto& index = *this->spatialIndex;
+	
+	if(index.dirty){
+		index.rebuild(this->children());
+	}
+	
+	std::vector<size_t> candidates = index.query(pos);
+	
+	//children which were hovered need to be notified and un-hovered if pointer has left them
+	auto& hovered = index.hovered[pointerID];
+	for(auto w : hovered){
+		ASSERT(index.zOrder.find(w) != index.zOrder.end())
+		candidates.push_back(index.zOrder[w]);
+	}
+	
+	//child which has captured the pointer gets all mouse move events
+	{
+		auto i = this->mouseCaptureMap.find(pointerID);
+		if(i != this->mouseCaptureMap.end()){
+			if(auto w = i->second.first.lock()){
+				ASSERT(index.zOrder.find(w.get()) != index.zOrder.end())
+				candidates.push_back(index.zOrder[w.get()]);
+			}
+		}
+	}
+	
+	std::sort(candidates.begin(), candidates.end(), std::greater<size_t>());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	
+	std::vector<Widget*> nowHovered;
+	bool consumed = false;
+	
+	for(auto z : candidates){
+		Widget* w = index.children[z];
+		
+		if(consumed){
+			//un-hover rest of the children
+			w->setHovered(false, pointerID);
+			continue;
+		}
+		
+		if(!w->isInteractive()){
+			ASSERT(!w->isHovered())
+			continue;
+		}
+		
+		bool c = w->onMouseMove(pos - w->rect().p, pointerID);
+		
+		//set hovered goes after move notification because position of widget could change
+		//during handling the notification, so need to check after that for hovering
+		if(!w->rect().overlaps(pos)){
+			w->setHovered(false, pointerID);
+			continue;
+		}
+		
+		w->setHovered(true, pointerID);
+		nowHovered.push_back(w);
+		
+		consumed = c;
+	}
+	
+	hovered = std::move(nowHovered);
+	
+	if(consumed){
+		return true;
+	}
+	
+	return this->Widget::onMouseMove(pos, pointerID);
+}
+
+
+
+void Container::setChildHovered(Widget& w, bool isHovered, unsigned pointerID){
+	w.setHovered(isHovered, pointerID);
+	
+	if(!this->spatialIndex){
+		return;
+	}
+	
+	auto& hovered = this->spatialIndex->hovered[pointerID];
+	auto i = std::find(hovered.begin(), hovered.end(), &w);
+	if(isHovered){
+		if(i == hovered.end()){
+			hovered.push_back(&w);
+		}
+	}else{
+		if(i != hovered.end()){
+			hovered.erase(i);
+		}
+	}
+}
+
+
+
+void Container::setSpatialIndexEnabled(bool enable){
+	if(this->isSpatialIndexEnabled() == enable){
+		return;
+	}
+	
+	if(!enable){
+		this->spatialIndex.reset();
+		return;
+	}
+	
+	this->spatialIndex = utki::makeUnique<SpatialIndex>();
+	
+	for(auto& w : this->children()){
+		for(auto id : w->hovered){
+			this->spatialIndex->hovered[id].push_back(w.get());
+		}
+	}
+}
+
+
+
+void Container::SpatialIndex::rebuild(const T_ChildrenList& list){
+	this->dirty = false;
+	
+	this->children.clear();
+	this->zOrder.clear();
+	this->cells.clear();
+	this->numCells = kolme::Vec2ui(0);
+	
+	if(list.size() == 0){
+		return;
+	}
+	
+	Vec2r min = list.front()->rect().p;
+	Vec2r max = min + list.front()->rect().d;
+	
+	for(auto& w : list){
+		this->zOrder[w.get()] = this->children.size();
+		this->children.push_back(w.get());
+		
+		const auto& r = w->rect();
+		min.x = std::min(min.x, r.p.x);
+		min.y = std::min(min.y, r.p.y);
+		max.x = std::max(max.x, r.p.x + r.d.x);
+		max.y = std::max(max.y, r.p.y + r.d.y);
+	}
+	
+	this->bb = Rectr(min, max - min);
+	
+	//choose number of cells proportionally to the aspect ratio of the bounding box
+	real totalCells = std::ceil(real(list.size()) / childrenPerCell_c);
+	real nx = 1;
+	if(this->bb.d.x > 0 && this->bb.d.y > 0){
+		nx = std::round(std::sqrt(totalCells * this->bb.d.x / this->bb.d.y));
+	}else if(this->bb.d.x > 0){
+		nx = totalCells;
+	}
+	utki::clampRange(nx, real(1), real(maxCellsPerAxis_c));
+	real ny = std::ceil(totalCells / nx);
+	utki::clampRange(ny, real(1), real(maxCellsPerAxis_c));
+	
+	this->numCells = kolme::Vec2ui(unsigned(nx), unsigned(ny));
+	this->cellDim = this->bb.d.compDiv(Vec2r(nx, ny));
+	
+	this->cells.resize(this->numCells.x * this->numCells.y);
+	
+	for(size_t z = 0; z != this->children.size(); ++z){
+		const auto& r = this->children[z]->rect();
+		
+		unsigned x0 = cellIndex(r.p.x, this->bb.p.x, this->cellDim.x, this->numCells.x);
+		unsigned x1 = cellIndex(r.p.x + r.d.x, this->bb.p.x, this->cellDim.x, this->numCells.x);
+		unsigned y0 = cellIndex(r.p.y, this->bb.p.y, this->cellDim.y, this->numCells.y);
+		unsigned y1 = cellIndex(r.p.y + r.d.y, this->bb.p.y, this->cellDim.y, this->numCells.y);
+		
+		for(unsigned y = y0; y <= y1; ++y){
+			for(unsigned x = x0; x <= x1; ++x){
+				this->cells[y * this->numCells.x + x].push_back(z);
+			}
+		}
+	}
+}
+
+
+
+std::vector<size_t> Container::SpatialIndex::query(const morda::Vec2r& pos){
+	ASSERT(!this->dirty)
+	
+	if(this->cells.size() == 0){
+		return std::vector<size_t>();
+	}
+	
+	if(pos.x < this->bb.p.x || pos.y < this->bb.p.y || pos.x > this->bb.p.x + this->bb.d.x || pos.y > this->bb.p.y + this->bb.d.y){
+		return std::vector<size_t>();
+	}
+	
+	const auto& cell = this->cells[
+			cellIndex(pos.y, this->bb.p.y, this->cellDim.y, this->numCells.y) * this->numCells.x
+					+ cellIndex(pos.x, this->bb.p.x, this->cellDim.x, this->numCells.x)
+		];
+	
+	return std::vector<size_t>(cell.rbegin(), cell.rend());
+}
+
+
+
 void Container::layOut(){
 //	TRACE(<< "Container::layOut(): invoked" << std::endl)
+	if(this->spatialIndex){
+		this->spatialIndex->dirty = true;
+	}
+	
 	BlockedFlagGuard blockedFlagGuard(this->isBlocked);
 	for(auto& w : this->children()){
 		if(w->needsRelayout()){
@@ -240,6 +507,12 @@ Widget::T_ChildrenList::iterator Container::add(const std::shared_ptr<Widget>& w
 	
 	w->parentIter = ret;
 	w->parentContainer = this;
+	w->invalidate();
+	
+	if(this->spatialIndex){
+		this->spatialIndex->dirty = true;
+	}
+
 	w->onParentChanged();
 	
 	this->onChildrenListChanged();
@@ -273,6 +546,15 @@ std::shared_ptr<Widget> Container::remove(Widget& w){
 	
 	auto ret = *w.parentIter;
 	
+	w.invalidate();
+	
+	if(this->spatialIndex){
+		this->spatialIndex->dirty = true;
+		for(auto& h : this->spatialIndex->hovered){
+			h.second.erase(std::remove(h.second.begin(), h.second.end(), &w), h.second.end());
+		}
+	}
+	
 	this->children_var.erase(w.parentIter);
 	
 	w.parentContainer = nullptr;
@@ -2,6 +2,8 @@
 
 #include <map>
 #include <list>
+#include <vector>
+#include <unordered_map>
 
 #include <utki/Unique.hpp>
 
@@ -27,8 +29,11 @@ namespace morda{
  *     }
  * }
  * @endcode
+ * @param spatialIndex - enable (true) or disable (false) spatial index of children for faster dispatching of mouse events. Default value is false.
+ *                       See setSpatialIndexEnabled() for details.
  */
 class Container : virtual public Widget{
+	friend class Widget;
 
 private:
 	T_ChildrenList children_var;
@@ -40,6 +45,34 @@ private:
 	//flag indicating that modifications to children list are blocked
 	bool isBlocked = false;
 	
+	//Uniform grid over the bounding box of children, each cell holds z-order indices of children overlapping it.
+	//It is rebuilt lazily when children list, layout or position or size of any child changes.
+	struct SpatialIndex{
+		bool dirty = true;
+		
+		morda::Rectr bb;
+		kolme::Vec2ui numCells;
+		morda::Vec2r cellDim;
+		std::vector<std::vector<size_t>> cells;
+		
+		//children in z-order
+		std::vector<Widget*> children;
+		std::unordered_map<const Widget*, size_t> zOrder;
+		
+		//Children hovered by each pointer, so that only hovered children need to be checked when pointer moves.
+		std::map<unsigned, std::vector<Widget*>> hovered;
+		
+		void rebuild(const T_ChildrenList& list);
+		
+		//returns z-order indices of children which may contain the point, in descending z-order
+		std::vector<size_t> query(const morda::Vec2r& pos);
+	};
+	
+	std::unique_ptr<SpatialIndex> spatialIndex;
+	
+	bool onMouseMoveIndexed(const morda::Vec2r& pos, unsigned pointerID);
+	
+	void setChildHovered(Widget& w, bool isHovered, unsigned pointerID);
 	
 protected:
 	/**
@@ -91,6 +124,17 @@ protected:
 		return *p;
 	}
 	
+	/**
+	 * @brief Convert damaged area of child widget to this container's coordinates.
+	 * Containers which render their children with additional transformation should override this method
+	 * to apply that transformation, so that damaged areas are reported at the right place.
+	 * @param damage - damaged rectangle in child widgets' coordinates, i.e. already offset by child's position.
+	 * @return Damaged rectangle in this container's coordinates.
+	 */
+	virtual Rectr childDamageToLocal(Rectr damage)const noexcept{
+		return damage;
+	}
+	
 public:
 	/**
 	 * @brief Get layout parameters of child widget.
@@ -206,6 +250,25 @@ public:
 		return this->children_var;
 	}
 	
+	/**
+	 * @brief Enable or disable spatial index of children.
+	 * Spatial index speeds up finding children under the mouse pointer, it is useful for containers having lots of children.
+	 * With spatial index enabled, mouse move events are passed only to children under the mouse pointer,
+	 * to children which were hovered before the event and to the child which has captured the pointer.
+	 * Without spatial index mouse move events are passed to all children.
+	 * @param enable - whether to enable (true) or disable (false) the spatial index.
+	 */
+	void setSpatialIndexEnabled(bool enable);
+	
+	/**
+	 * @brief Check if spatial index of children is enabled.
+	 * @return true if spatial index is enabled.
+	 * @return false otherwise.
+	 */
+	bool isSpatialIndexEnabled()const noexcept{
+		return this->spatialIndex.operator bool();
+	}
+	
 	/**
 	 * @brief Called when children list changes.
 	 * This implementation requests re-layout.
@@ -16,28 +16,38 @@ ScrollArea::ScrollArea(const stob::Node* chain) :
 
 
 
-bool ScrollArea::onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_e button, unsigned pointerID) {
+Vec2r ScrollArea::childrenOffset()const noexcept{
 	Vec2r d = this->curScrollPos;
 	d.y -= this->effectiveDim.y;
 	d.x = -d.x;
+	return d;
+}
+
+
+
+Rectr ScrollArea::childDamageToLocal(Rectr damage)const noexcept{
+	damage.p += this->childrenOffset();
+	return damage;
+}
+
+
+
+bool ScrollArea::onMouseButton(bool isDown, const morda::Vec2r& pos, MouseButton_e button, unsigned pointerID) {
+	Vec2r d = this->childrenOffset();
 	return this->Container::onMouseButton(isDown, pos - d, button, pointerID);
 }
 
 
 
 bool ScrollArea::onMouseMove(const morda::Vec2r& pos, unsigned pointerID) {
-	Vec2r d = this->curScrollPos;
-	d.y -= this->effectiveDim.y;
-	d.x = -d.x;
+	Vec2r d = this->childrenOffset();
 	return this->Container::onMouseMove(pos - d, pointerID);
 }
 
 
 
 void ScrollArea::render(const morda::Matr4r& matrix) const {
-	Vec2r d = this->curScrollPos;
-	d.y -= this->effectiveDim.y;
-	d.x = -d.x;
+	Vec2r d = this->childrenOffset();
 	
 	Matr4r matr(matrix);
 	matr.translate(d);
@@ -58,10 +68,16 @@ void ScrollArea::clampScrollPos() {
 
 
 void ScrollArea::setScrollPos(const Vec2r& newScrollPos) {
+	Vec2r oldScrollPos = this->curScrollPos;
+	
 	this->curScrollPos = newScrollPos.rounded();
 	
 	this->clampScrollPos();
 	this->updateScrollFactor();
+	
+	if(this->curScrollPos != oldScrollPos){
+		this->invalidate();
+	}
 }
 
 
@@ -105,6 +121,8 @@ void ScrollArea::layOut(){
 	this->arrangeWidgets();
 	this->updateEffectiveDim();
 
+	Vec2r oldScrollPos = this->curScrollPos;
+	
 	//distance of content's bottom right corner from bottom right corner of the ScrollArea
 	Vec2r br = this->curScrollPos - this->effectiveDim;
 
@@ -123,6 +141,10 @@ void ScrollArea::layOut(){
 			this->curScrollPos.y = 0;
 		}
 	}
+	
+	if(this->curScrollPos != oldScrollPos){
+		this->invalidate();
+	}
 }
 
 void ScrollArea::onChildrenListChanged(){
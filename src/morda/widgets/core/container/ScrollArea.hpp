@@ -23,6 +23,12 @@ class ScrollArea : public Container{
 	//cached scroll factor
 	Vec2r curScrollFactor;
 	
+	//offset of children in scroll area coordinates
+	Vec2r childrenOffset()const noexcept;
+	
+protected:
+	Rectr childDamageToLocal(Rectr damage)const noexcept override;
+	
 public:
 	ScrollArea(const stob::Node* chain = nullptr);
 	
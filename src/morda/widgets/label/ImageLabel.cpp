@@ -14,8 +14,24 @@ ImageLabel::ImageLabel(const stob::Node* chain) :
 		BlendWidget(chain)
 {
 	if(auto image = getProperty(chain, "image")){
-		this->img = Morda::inst().resMan.load<ResImage>(image->value());
-		this->resize(this->img->dim());
+		bool async = false;
+		if(auto n = getProperty(chain, "async")){
+			async = n->asBool();
+		}
+		
+		if(async){
+			std::shared_ptr<const ResImage> placeholder;
+			if(auto n = getProperty(chain, "placeholder")){
+				placeholder = Morda::inst().resMan.load<ResImage>(n->value());
+			}
+			this->setImageAsync(image->value(), placeholder);
+		}else{
+			this->img = Morda::inst().resMan.load<ResImage>(image->value());
+		}
+		
+		if(this->img){
+			this->resize(this->img->dim());
+		}
 	}
 	
 	if(auto n = getProperty(chain, "keepAspectRatio")){
@@ -48,6 +64,7 @@ void ImageLabel::render(const morda::Matr4r& matrix) const{
 	
 	if(!this->scaledImage){
 		this->scaledImage = this->img->get(this->rect().d);
+		this->scaledImage->addUser(std::const_pointer_cast<ImageLabel>(this->sharedFromThis(this)));
 
 		if(this->repeat_v.x || this->repeat_v.y){
 			ASSERT(PosTexShader::quadFanTexCoords.size() == this->texCoords.size())
@@ -134,6 +151,35 @@ void ImageLabel::setImage(const std::shared_ptr<const ResImage>& image) {
 	
 	this->img = image;
 	this->scaledImage.reset();
+	this->invalidate();
+	
+	this->asyncLoadToken.reset();
+}
+
+
+
+void ImageLabel::setImageAsync(const char* resName, const std::shared_ptr<const ResImage>& placeholder){
+	this->setImage(placeholder);
+	
+	this->asyncLoadToken = std::make_shared<bool>(true);
+	
+	std::weak_ptr<bool> token = this->asyncLoadToken;
+	
+	Morda::inst().resMan.loadAsync<ResImage>(
+			resName,
+			[this, token](std::shared_ptr<ResImage> image){
+				if(token.expired()){
+					//widget is destroyed or another image was set
+					return;
+				}
+				if(!image){
+					//loading failed, leave placeholder
+					this->asyncLoadToken.reset();
+					return;
+				}
+				this->setImage(image);
+			}
+		);
 }
 
 void ImageLabel::onResize() {
@@ -15,6 +15,8 @@ namespace morda{
  * From GUI script it can be instantiated as "ImageLabel".
  * 
  * @param image - image resource.
+ * @param async - load image resource asynchronously, i.e. without blocking UI thread, false by default.
+ * @param placeholder - image resource to show while the image is being loaded asynchronously.
  * @param keepAspectRatio - try to keep aspect ratio of the image when scaling.
  * @param repeatX - replicate image horizontally if size of the widget is bigger than size of the image resource.
  * @param repeatY - replicate image vertically if size of the widget is bigger than size of the image resource.
@@ -35,6 +37,10 @@ class ImageLabel :
 	kolme::Vec2b repeat_v;
 	mutable std::array<kolme::Vec2f, 4> texCoords;
 	
+	//Token of the current asynchronous image loading, reset when the loading is superseded.
+	//Callbacks hold weak pointer to it, so they can tell if the widget still waits for that image.
+	std::shared_ptr<bool> asyncLoadToken;
+	
 public:
 	ImageLabel(const stob::Node* chain = nullptr);
 public:
@@ -46,6 +52,16 @@ public:
 	
 	void setImage(const std::shared_ptr<const ResImage>& image);
 	
+	/**
+	 * @brief Set image resource loaded asynchronously.
+	 * Starts asynchronous loading of the image resource and shows placeholder image until the resource is loaded.
+	 * If the image resource is already loaded, then it is set right away.
+	 * Subsequent call to setImage() or setImageAsync() cancels setting of the image which is being loaded.
+	 * @param resName - name of the image resource.
+	 * @param placeholder - image to show while the resource is being loaded, can be nullptr.
+	 */
+	void setImageAsync(const char* resName, const std::shared_ptr<const ResImage>& placeholder = nullptr);
+	
 	void onResize() override;
 	
 	const decltype(repeat_v)& repeat()const noexcept{
@@ -31,5 +31,5 @@ void TextLabel::render(const morda::Matr4r& matrix)const{
 		}
 	}();
 	
-	this->font().renderString(s, matr, this->text());
+	this->font().renderString(s, matr, this->glyphRun());
 }
@@ -154,6 +154,7 @@ public:
 	
 	void update(std::uint32_t dt) override{
 		this->rot %= morda::Quatr().initRot(kolme::Vec3f(1, 2, 1).normalize(), 1.5f * (float(dt) / 1000));
+		this->invalidate();
 	}
 	
 	void render(const morda::Matr4r& matrix)const override{
@@ -22,13 +22,50 @@ App::T_Instance App::instance;
 
 
 void App::render(){
-	//TODO: render only if needed?
+	auto viewportDim = morda::Render::getViewport().d;
+	if(viewportDim.x <= 0 || viewportDim.y <= 0){
+		return;
+	}
+	
+	if(!this->guiTex || this->guiTex.dim() != viewportDim.to<morda::real>()){
+		this->guiTex = morda::Texture2D(
+				viewportDim.to<unsigned>(),
+				4,
+				morda::Render::TexFilter_e::NEAREST,
+				morda::Render::TexFilter_e::NEAREST
+			);
+		this->gui.setWholeDamaged();
+	}
+	
+	//re-render damaged areas of GUI
+	this->guiFrameBuffer.bind();
+	this->guiFrameBuffer.attachColor(std::move(this->guiTex));
+	
+	this->gui.renderDamage();
+	
+	this->guiTex = this->guiFrameBuffer.detachColor();
+	this->guiFrameBuffer.unbind();
 	
+	//copy GUI to screen
 	morda::Render::clearColor();
 	morda::Render::clearDepth();
 	morda::Render::clearStencil();
-
-	this->gui.render();
+	
+	morda::Render::setBlendEnabled(false);
+	
+	morda::PosTexShader& s = this->gui.shaders.posTexShader;
+	
+	this->guiTex.bind();
+	
+	morda::Matr4r matrix;
+	matrix.identity();
+	matrix.translate(-1, -1);
+	matrix.scale(morda::Vec2r(2));
+	s.setMatrix(matrix);
+	
+	s.render(utki::wrapBuf(morda::PosShader::quad01Fan), utki::wrapBuf(s.quadFanTexCoords));
+	
+	morda::Render::flush();
 	
 	this->swapFrameBuffers();
 }
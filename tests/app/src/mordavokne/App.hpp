@@ -13,6 +13,7 @@
 #include <kolme/Vector2.hpp>
 
 #include "../../../../src/morda/Morda.hpp"
+#include "../../../../src/morda/render/FrameBuffer.hpp"
 
 
 
@@ -365,6 +366,10 @@ private:
 		}
 	} gui;
 	
+	//GUI is rendered to this off-screen target, only damaged areas are re-rendered, then it is copied to screen
+	morda::FrameBuffer guiFrameBuffer;
+	morda::Texture2D guiTex;
+	
 public:
 
 	/**
@@ -777,7 +777,10 @@ void App::exec(){
 	}
 	
 	do{
-		this->render();
+		//render only if something has changed, no need to redraw on wakeups caused by timers or events which did not affect GUI
+		if(this->gui.needsRedraw()){
+			this->render();
+		}
 		
 		std::uint32_t millis = this->gui.update();
 		
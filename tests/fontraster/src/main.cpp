@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include <utki/debug.hpp>
+
+#include "../../app/src/mordavokne/AppFactory.hpp"
+
+#include "../../../src/morda/fonts/TexFont.hpp"
+
+
+
+namespace{
+
+const unsigned numRuns_c = 3;
+
+//Characters of Latin, Greek, Cyrillic and other scripts up to U+07FF, about 2000 glyphs.
+std::u32string makeCharset(){
+	std::u32string ret;
+	for(char32_t c = 0x20; c != 0x800; ++c){
+		ret.append(1, c);
+	}
+	return ret;
+}
+
+
+
+//Rasterize the font several times, return the best rasterization speed in glyphs per second.
+double measure(const papki::File& fi, const std::u32string& chars, unsigned fontSize, unsigned& outNumThreads){
+	double ret = 0;
+	for(unsigned i = 0; i != numRuns_c; ++i){
+		morda::TexFont font(fi, chars, fontSize);
+
+		auto& s = font.loadStats();
+		outNumThreads = s.numThreads;
+
+		double seconds = std::max(double(s.rasterizeTime), 1.0) / 1000000.0;
+		ret = std::max(ret, double(s.numGlyphs) / seconds);
+	}
+	return ret;
+}
+
+}
+
+
+
+class Application : public mordavokne::App{
+public:
+	Application() :
+			App(mordavokne::App::WindowParams(kolme::Vec2ui(320, 240)))
+	{
+		auto fi = this->createResourceFileInterface("../../res/morda_res/fonts/Vera.ttf");
+
+		auto chars = makeCharset();
+
+		const unsigned fontSizes[] = {16, 32, 64};
+
+		auto oldMaxThreads = morda::TexFont::maxRasterThreads();
+
+		std::cout << "rasterizing " << chars.size() << " glyphs" << std::endl;
+
+		for(auto s : fontSizes){
+			morda::TexFont::setMaxRasterThreads(1);
+			unsigned singleThreads;
+			double single = measure(*fi, chars, s, singleThreads);
+
+			morda::TexFont::setMaxRasterThreads(0);
+			unsigned multiThreads;
+			double multi = measure(*fi, chars, s, multiThreads);
+
+			std::cout << "font size " << std::setw(2) << s << ": "
+					<< std::fixed << std::setprecision(0)
+					<< singleThreads << " thread " << std::setw(8) << single << " glyphs/s, "
+					<< multiThreads << " threads " << std::setw(8) << multi << " glyphs/s, "
+					<< "speedup " << std::setprecision(2) << (multi / single)
+					<< std::endl;
+		}
+
+		morda::TexFont::setMaxRasterThreads(oldMaxThreads);
+
+		this->quit();
+	}
+};
+
+
+
+std::unique_ptr<mordavokne::App> mordavokne::createApp(int argc, const char** argv, const utki::Buf<std::uint8_t> savedState){
+	return utki::makeUnique<Application>();
+}
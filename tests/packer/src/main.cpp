@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <kolme/Vector2.hpp>
+
+#include "../../../src/morda/util/SkylinePacker.hpp"
+#include "../../../src/morda/Exc.hpp"
+
+
+namespace{
+
+const unsigned maxTexDim_c = 4096;
+
+const unsigned gap_c = 1;
+
+const unsigned numIterations_c = 20;
+
+
+
+unsigned nextPowOf2(unsigned n){
+	unsigned ret = 1;
+	while(ret < n){
+		ret <<= 1;
+	}
+	return ret;
+}
+
+
+
+//Row-by-row packing which was used for font atlases before the skyline packer.
+//Glyphs are put in rows from left to right in the given order, texture height grows to the next power of 2 when needed.
+kolme::Vec2ui rowPack(const std::vector<kolme::Vec2ui>& dims, std::vector<kolme::Vec2ui>& outPositions, unsigned maxDim, unsigned fontSize){
+	outPositions.resize(dims.size());
+
+	//guess for texture width, assume that all glyphs will be placed in 8 rows
+	unsigned texWidth = std::max(unsigned(128), nextPowOf2(unsigned(dims.size() / 8) * fontSize));
+	texWidth = std::min(std::min(maxDim, unsigned(1024)), texWidth);
+
+	unsigned texHeight = nextPowOf2(fontSize);
+
+	unsigned curX = gap_c;
+	unsigned curY = gap_c;
+	unsigned rowHeight = 0;
+
+	for(size_t i = 0; i != dims.size(); ++i){
+		auto& d = dims[i];
+
+		if(texWidth < curX + d.x + gap_c){
+			curX = gap_c;
+			curY += rowHeight + gap_c;
+			rowHeight = 0;
+		}
+
+		if(texHeight < curY + d.y + gap_c){
+			texHeight = nextPowOf2(curY + d.y + gap_c);
+			if(texHeight > maxDim){
+				throw std::runtime_error("rowPack(): rectangles do not fit the area of maximum dimensions");
+			}
+		}
+
+		rowHeight = std::max(rowHeight, d.y);
+
+		outPositions[i] = kolme::Vec2ui(curX, curY);
+		curX += d.x + gap_c;
+	}
+
+	return kolme::Vec2ui(texWidth, texHeight);
+}
+
+
+
+//Check that rectangles are within the area and do not overlap.
+bool isPackingValid(const std::vector<kolme::Vec2ui>& dims, const std::vector<kolme::Vec2ui>& positions, kolme::Vec2ui area){
+	for(size_t i = 0; i != dims.size(); ++i){
+		auto& p = positions[i];
+		auto& d = dims[i];
+
+		if(p.x + d.x > area.x || p.y + d.y > area.y){
+			return false;
+		}
+
+		for(size_t j = i + 1; j != dims.size(); ++j){
+			auto& q = positions[j];
+			auto& e = dims[j];
+			if(p.x < q.x + e.x && q.x < p.x + d.x && p.y < q.y + e.y && q.y < p.y + d.y){
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//Generate dimensions of glyph images of the font of given size.
+//Glyph heights vary from lowercase letters to letters with descenders and accents, CJK glyphs are close to square.
+std::vector<kolme::Vec2ui> makeGlyphDims(size_t numGlyphs, unsigned fontSize, bool cjk){
+	std::mt19937 rng(unsigned(numGlyphs * 1000 + fontSize));
+
+	std::uniform_int_distribution<unsigned> width(fontSize / 4, fontSize * 3 / 4);
+	std::uniform_int_distribution<unsigned> height(fontSize / 3, fontSize);
+	std::uniform_int_distribution<unsigned> cjkDim(fontSize * 3 / 4, fontSize);
+
+	std::vector<kolme::Vec2ui> ret;
+	ret.reserve(numGlyphs);
+	for(size_t i = 0; i != numGlyphs; ++i){
+		if(cjk){
+			ret.push_back(kolme::Vec2ui(cjkDim(rng), cjkDim(rng)));
+		}else{
+			ret.push_back(kolme::Vec2ui(width(rng), height(rng)));
+		}
+	}
+	return ret;
+}
+
+
+
+struct Result{
+	bool fits = false;
+	bool valid = false;
+	kolme::Vec2ui area;
+	double occupancy = 0;
+	double microseconds = 0;
+};
+
+
+
+template <class T_Pack> Result measure(const std::vector<kolme::Vec2ui>& dims, T_Pack pack){
+	Result ret;
+
+	std::vector<kolme::Vec2ui> positions;
+
+	try{
+		ret.area = pack(dims, positions);
+	}catch(std::exception&){
+		return ret;
+	}
+	ret.fits = true;
+
+	ret.valid = isPackingValid(dims, positions, ret.area);
+
+	size_t used = 0;
+	for(auto& d : dims){
+		used += size_t(d.x) * size_t(d.y);
+	}
+	ret.occupancy = double(used) / (double(ret.area.x) * double(ret.area.y));
+
+	auto start = std::chrono::steady_clock::now();
+	for(unsigned i = 0; i != numIterations_c; ++i){
+		pack(dims, positions);
+	}
+	ret.microseconds = double(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()) / numIterations_c;
+
+	return ret;
+}
+
+
+
+void print(const char* packer, const Result& r){
+	std::cout << "    " << std::setw(8) << std::left << packer << std::right;
+	if(!r.fits){
+		std::cout << " does not fit " << maxTexDim_c << "x" << maxTexDim_c << std::endl;
+		return;
+	}
+	std::cout << " area = " << std::setw(4) << r.area.x << "x" << std::setw(4) << std::left << r.area.y << std::right
+			<< " occupancy = " << std::fixed << std::setprecision(1) << std::setw(5) << (r.occupancy * 100) << "%"
+			<< " time = " << std::setprecision(1) << std::setw(8) << r.microseconds << " us"
+			<< (r.valid ? "" : " INVALID PACKING")
+			<< std::endl;
+}
+
+}
+
+
+
+int main(int argc, char** argv){
+	struct Case{
+		const char* name;
+		size_t numGlyphs;
+		bool cjk;
+	};
+
+	const Case cases[] = {
+		{"ASCII", 96, false},
+		{"Latin + Cyrillic", 400, false},
+		{"CJK", 3000, true}
+	};
+
+	const unsigned fontSizes[] = {12, 24, 48};
+
+	bool failed = false;
+
+	for(auto& c : cases){
+		for(auto s : fontSizes){
+			auto dims = makeGlyphDims(c.numGlyphs, s, c.cjk);
+
+			std::cout << c.name << ", " << c.numGlyphs << " glyphs, font size " << s << std::endl;
+
+			auto row = measure(dims, [s](const std::vector<kolme::Vec2ui>& d, std::vector<kolme::Vec2ui>& p){
+				return rowPack(d, p, maxTexDim_c, s);
+			});
+			print("row", row);
+
+			auto skyline = measure(dims, [](const std::vector<kolme::Vec2ui>& d, std::vector<kolme::Vec2ui>& p){
+				return morda::SkylinePacker::pack(d, p, maxTexDim_c, gap_c);
+			});
+			print("skyline", skyline);
+
+			if((row.fits && !row.valid) || !skyline.fits || !skyline.valid){
+				failed = true;
+			}
+		}
+	}
+
+	return failed ? 1 : 0;
+}